@@ -0,0 +1,172 @@
+#include "corpus.h"
+
+namespace hid::bench {
+
+namespace {
+
+// Short item prefixes (tag and type, size bits zero)
+enum : uint8_t {
+    input = 0x80, output = 0x90, feature = 0xB0, collection = 0xA0, end_collection = 0xC0,
+    usage_page = 0x04, logical_min = 0x14, logical_max = 0x24, physical_min = 0x34, physical_max = 0x44,
+    unit_exponent = 0x54, unit = 0x64, report_size = 0x74, report_id = 0x84, report_count = 0x94,
+    usage = 0x08, usage_min = 0x18, usage_max = 0x28,
+};
+
+// Collection types
+enum : uint8_t { physical = 0x00, application = 0x01, logical = 0x02 };
+
+// Main item data
+enum : uint8_t { data_array = 0x00, constant = 0x01, data_var = 0x02, data_var_null = 0x42 };
+
+// Appends short items with the smallest data size that holds the value.
+class builder
+{
+public:
+    builder& operator()(uint8_t prefix) {
+        bytes.push_back(prefix);
+        return *this;
+    }
+
+    // Extents are signed, so e.g. a Logical Maximum of 255 takes two bytes
+    builder& operator()(uint8_t prefix, uint32_t value) {
+        if (prefix == logical_min || prefix == logical_max || prefix == physical_min || prefix == physical_max) {
+            return s(prefix, static_cast<int32_t>(value));
+        }
+        if (value <= 0xFF) return put(prefix | 1, value, 1);
+        if (value <= 0xFFFF) return put(prefix | 2, value, 2);
+        return put(prefix | 3, value, 4);
+    }
+
+    builder& s(uint8_t prefix, int32_t value) {
+        if (value >= -0x80 && value <= 0x7F) return put(prefix | 1, static_cast<uint32_t>(value), 1);
+        if (value >= -0x8000 && value <= 0x7FFF) return put(prefix | 2, static_cast<uint32_t>(value), 2);
+        return put(prefix | 3, static_cast<uint32_t>(value), 4);
+    }
+
+    std::vector<uint8_t> bytes;
+
+private:
+    builder& put(uint8_t prefix, uint32_t value, int size) {
+        bytes.push_back(prefix);
+        for (int i = 0; i < size; ++i) bytes.push_back(static_cast<uint8_t>(value >> (8 * i)));
+        return *this;
+    }
+};
+
+// HID 1.11 Appendix B.1, byte for byte
+std::vector<uint8_t> boot_keyboard() {
+    return {
+        0x05, 0x01, 0x09, 0x06, 0xA1, 0x01, 0x05, 0x07, 0x19, 0xE0, 0x29, 0xE7, 0x15, 0x00, 0x25, 0x01,
+        0x75, 0x01, 0x95, 0x08, 0x81, 0x02, 0x95, 0x01, 0x75, 0x08, 0x81, 0x01, 0x95, 0x05, 0x75, 0x01,
+        0x05, 0x08, 0x19, 0x01, 0x29, 0x05, 0x91, 0x02, 0x95, 0x01, 0x75, 0x03, 0x91, 0x01, 0x95, 0x06,
+        0x75, 0x08, 0x15, 0x00, 0x25, 0x65, 0x05, 0x07, 0x19, 0x00, 0x29, 0x65, 0x81, 0x00, 0xC0,
+    };
+}
+
+// Multi-touch screen in the layout Windows touch firmware uses: ten Finger
+// logical collections in one input report, contact count and scan time, a
+// Contact Count Maximum feature and the 256-byte certification blob.
+std::vector<uint8_t> touch_screen() {
+    builder b;
+    b(usage_page, 0x0D)(usage, 0x04)(collection, application)(report_id, 1);
+    for (int finger = 0; finger < 10; ++finger) {
+        b(usage_page, 0x0D)(usage, 0x22)(collection, logical);
+        b(usage, 0x42)(usage, 0x32)(logical_min, 0)(logical_max, 1)(report_size, 1)(report_count, 2)(input, data_var);
+        b(report_count, 6)(input, constant);
+        b(usage, 0x51)(report_size, 8)(report_count, 1)(logical_max, 0xFF)(input, data_var);
+        b(usage_page, 0x01)(unit_exponent, 0x0E)(unit, 0x11)(report_size, 16);
+        b(logical_max, 4095)(physical_max, 2540)(usage, 0x30)(input, data_var);
+        b(logical_max, 2399)(physical_max, 1488)(usage, 0x31)(input, data_var);
+        b(usage_page, 0x0D)(usage, 0x48)(usage, 0x49)(report_count, 2)(input, data_var);
+        b(end_collection);
+    }
+    b(usage_page, 0x0D)(usage, 0x54)(logical_max, 10)(report_size, 8)(report_count, 1)(input, data_var);
+    b(usage, 0x56)(unit_exponent, 0x0C)(unit, 0x1001)(logical_max, 0xFFFF)(report_size, 16)(input, data_var);
+    b(report_id, 2)(usage, 0x55)(logical_max, 10)(report_size, 8)(feature, data_var);
+    b(usage_page, 0xFF00)(report_id, 3)(usage, 0xC5)(logical_max, 0xFF)(report_count, 256)(feature, data_var);
+    b(end_collection);
+    return std::move(b.bytes);
+}
+
+// Gamepad: 16 buttons, hat switch with a null state, two sticks and two
+// triggers, plus a rumble output report and a vendor calibration feature.
+std::vector<uint8_t> gamepad() {
+    builder b;
+    b(usage_page, 0x01)(usage, 0x05)(collection, application)(report_id, 1);
+    b(usage_page, 0x09)(usage_min, 1)(usage_max, 16)(logical_min, 0)(logical_max, 1)(report_size, 1)(report_count, 16)(input, data_var);
+    b(usage_page, 0x01)(usage, 0x39)(logical_max, 7)(physical_max, 315)(unit, 0x14)(report_size, 4)(report_count, 1)(input, data_var_null);
+    b(unit, 0)(report_count, 1)(input, constant);
+    b(collection, physical)(usage, 0x30)(usage, 0x31)(usage, 0x33)(usage, 0x34);
+    b.s(logical_min, -32768)(logical_max, 32767)(report_size, 16)(report_count, 4)(input, data_var)(end_collection);
+    b(usage_page, 0x02)(usage, 0xC5)(usage, 0xC4)(logical_min, 0)(logical_max, 1023)(report_size, 10)(report_count, 2)(input, data_var);
+    b(report_size, 4)(report_count, 1)(input, constant);
+    b(report_id, 2)(usage_page, 0x0F)(usage, 0x97)(collection, logical);
+    b(usage, 0x7C)(logical_max, 100)(report_size, 8)(report_count, 4)(output, data_var)(end_collection);
+    b(report_id, 3)(usage_page, 0xFF00)(usage, 0x01)(logical_max, 0xFF)(report_count, 32)(feature, data_var);
+    b(end_collection);
+    return std::move(b.bytes);
+}
+
+// Vendor-defined device with 200 input/output/feature report triplets, the
+// shape of firmware-update and telemetry interfaces (~4 KiB of descriptor).
+std::vector<uint8_t> vendor_large() {
+    builder b;
+    b(usage_page, 0xFF00)(usage, 0x01)(collection, application)(logical_min, 0)(logical_max, 0xFF)(report_size, 8);
+    for (uint32_t id = 1; id <= 200; ++id) {
+        b(report_id, id)(usage, 0x10 + id)(report_count, 63)(input, data_var);
+        b(usage, 0x20 + id)(output, data_var);
+        b(usage, 0x30 + id)(report_count, 15)(feature, data_var);
+    }
+    b(end_collection);
+    return std::move(b.bytes);
+}
+
+// Array fields whose usage lists are long runs of disjoint Usage Minimum/
+// Maximum pairs and scattered single Usages, each spanning thousands of values.
+std::vector<uint8_t> usage_ranges() {
+    builder b;
+    b(usage_page, 0x07)(usage, 0x06)(collection, application)(logical_min, 0);
+    for (uint32_t report = 1; report <= 8; ++report) {
+        b(report_id, report);
+        for (uint32_t r = 0; r < 64; ++r) {
+            const uint32_t base = (report << 20) + r * 0x1000;
+            b(usage_min, base)(usage_max, base + 0x7FF)(usage, base + 0x900)(usage, base + 0xA00);
+        }
+        b(logical_max, 64 * 0x802)(report_size, 24)(report_count, 16)(input, data_array);
+        b(usage_min, 0)(usage_max, 0xFFFF)(logical_max, 0xFFFF)(report_size, 16)(report_count, 32)(input, data_array);
+    }
+    b(end_collection);
+    return std::move(b.bytes);
+}
+
+} // namespace
+
+const std::vector<corpus_entry>& corpus() {
+    static const std::vector<corpus_entry> entries = [] {
+        std::vector<corpus_entry> v;
+        v.push_back({"keyboard", boot_keyboard()});
+        v.push_back({"touch_screen", touch_screen()});
+        v.push_back({"gamepad", gamepad()});
+        v.push_back({"vendor_large", vendor_large()});
+        v.push_back({"usage_ranges", usage_ranges()});
+        return v;
+    }();
+    return entries;
+}
+
+std::size_t count_items(std::span<const uint8_t> bytes) noexcept {
+    std::size_t n = 0;
+    for (std::size_t i = 0; i < bytes.size(); ++n) {
+        const uint8_t prefix = bytes[i];
+        if (prefix == 0xFE) {
+            // Long item: prefix, data size, long tag, data
+            i += 3 + (i + 1 < bytes.size() ? bytes[i + 1] : 0);
+        } else {
+            static constexpr uint8_t sizes[4] = {0, 1, 2, 4};
+            i += 1 + sizes[prefix & 3];
+        }
+    }
+    return n;
+}
+
+} // namespace hid::bench
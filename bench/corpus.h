@@ -0,0 +1,25 @@
+#pragma once
+
+#include <cstdint>
+#include <span>
+#include <string_view>
+#include <vector>
+
+namespace hid::bench {
+
+// A report descriptor the benchmarks run against.
+struct corpus_entry {
+    std::string_view name;
+    std::vector<uint8_t> bytes;
+};
+
+// Fixed set of descriptors shaped like real devices: a boot keyboard, a
+// 10-finger touch screen, a gamepad with rumble, a large vendor-defined
+// device and one made of pathological Usage Minimum/Maximum ranges. The
+// bytes are identical on every run, so results stay comparable over time.
+const std::vector<corpus_entry>& corpus();
+
+// Number of short and long items in a descriptor (a truncated trailing item counts).
+std::size_t count_items(std::span<const uint8_t> bytes) noexcept;
+
+} // namespace hid::bench
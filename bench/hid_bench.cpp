@@ -0,0 +1,237 @@
+/*
+ * Microbenchmarks for descriptor parsing, report index build, report decoding,
+ * dumping and the hex codec, run over the fixed corpus in corpus.cpp.
+ * Usage:
+ *  hidbench [--filter <substring>] [--min-time-ms <n>]
+ *   - Prints one JSON object per benchmark to stdout and a table to stderr.
+ *   - --filter runs only benchmarks whose "<bench>/<descriptor>" name contains <substring>.
+ *   - --min-time-ms sets how long each benchmark is repeated for (default 200).
+ */
+#include <print>
+#include <algorithm>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <atomic>
+#include <chrono>
+#include <charconv>
+#include <cstdio>
+#include <cstdlib>
+#include <format>
+#include <functional>
+#include <new>
+#include <stdexcept>
+#include <utility>
+
+#include "corpus.h"
+#include "hex_codec.h"
+#include "hid_report_columns.h"
+#include "hid_report_decoder.h"
+#include "hid_report_desc.h"
+#include "hid_report_desc_dump.h"
+
+// Every allocation in the process is counted, so allocs_per_op covers the
+// library's internal containers as well as the returned objects.
+static std::atomic<uint64_t> allocations{0};
+
+void* operator new(std::size_t size) {
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void* p = std::malloc(size ? size : 1)) return p;
+    throw std::bad_alloc();
+}
+
+void* operator new(std::size_t size, std::align_val_t align) {
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    const std::size_t a = static_cast<std::size_t>(align);
+    if (void* p = std::aligned_alloc(a, (size + a - 1) / a * a)) return p;
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+void operator delete(void* p, std::align_val_t) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t, std::align_val_t) noexcept { std::free(p); }
+
+namespace {
+
+using namespace hid::bench;
+
+// Keeps the optimiser from discarding a result that is otherwise unused
+template<typename T>
+void keep(const T& value) {
+    asm volatile("" : : "r,m"(value) : "memory");
+}
+
+struct result {
+    std::string name;
+    uint64_t iterations;
+    double ns_per_op;
+    double allocs_per_op;
+    std::size_t bytes_per_op;
+    std::size_t items_per_op;
+};
+
+// Repeats op in doubling batches until a batch takes at least min_time.
+result measure(std::string name, std::size_t bytes_per_op, std::size_t items_per_op,
+    std::chrono::nanoseconds min_time, const std::function<void()>& op) {
+    op(); // warm caches and any lazily built tables
+    for (uint64_t n = 1;; n *= 2) {
+        const uint64_t allocs_before = allocations.load(std::memory_order_relaxed);
+        const auto start = std::chrono::steady_clock::now();
+        for (uint64_t i = 0; i < n; ++i) op();
+        const auto elapsed = std::chrono::steady_clock::now() - start;
+        if (elapsed >= min_time || n >= (uint64_t{1} << 40)) {
+            const uint64_t allocs = allocations.load(std::memory_order_relaxed) - allocs_before;
+            return {
+                .name = std::move(name),
+                .iterations = n,
+                .ns_per_op = static_cast<double>(std::chrono::nanoseconds(elapsed).count()) / static_cast<double>(n),
+                .allocs_per_op = static_cast<double>(allocs) / static_cast<double>(n),
+                .bytes_per_op = bytes_per_op,
+                .items_per_op = items_per_op,
+            };
+        }
+    }
+}
+
+void print_result(const result& r) {
+    const double per_s = r.ns_per_op > 0 ? 1e9 / r.ns_per_op : 0.0;
+    std::println("{{\"name\":\"{}\",\"iterations\":{},\"ns_per_op\":{:.1f},\"bytes_per_op\":{},\"items_per_op\":{},"
+        "\"bytes_per_s\":{:.0f},\"items_per_s\":{:.0f},\"allocs_per_op\":{:.2f}}}",
+        r.name, r.iterations, r.ns_per_op, r.bytes_per_op, r.items_per_op,
+        r.bytes_per_op * per_s, r.items_per_op * per_s, r.allocs_per_op);
+    std::println(stderr, "{:<28} {:>12.1f} ns/op {:>10.1f} MB/s {:>10.2f} Mitems/s {:>8.2f} allocs/op",
+        r.name, r.ns_per_op, r.bytes_per_op * per_s / 1e6, r.items_per_op * per_s / 1e6, r.allocs_per_op);
+}
+
+struct options {
+    std::string_view filter;
+    std::chrono::milliseconds min_time{200};
+};
+
+options parse_options(char* argv[]) {
+    options opts;
+    for (char** arg = &argv[1]; *arg; ++arg) {
+        const std::string_view opt = *arg;
+        if (!arg[1]) {
+            throw std::runtime_error(std::format("Missing value for {}", opt));
+        }
+        if (opt == "--filter") {
+            opts.filter = *++arg;
+        } else if (opt == "--min-time-ms") {
+            const std::string_view sv = *++arg;
+            uint64_t ms = 0;
+            auto [ptr, ec] = std::from_chars(sv.data(), sv.data() + sv.size(), ms);
+            if (sv.empty() || ec != std::errc{} || ptr != sv.data() + sv.size()) {
+                throw std::runtime_error(std::format("Wrong value for --min-time-ms: {}", sv));
+            }
+            opts.min_time = std::chrono::milliseconds(ms);
+        } else {
+            throw std::runtime_error(std::format("Unknown option: {}", opt));
+        }
+    }
+    return opts;
+}
+
+// (report ID, kind) pairs that have at least one field, i.e. what a session
+// compiles a decoder for
+std::vector<std::pair<uint8_t, hid::report_decoder::field_kind>> reports_of(const hid::report_descriptor_tree& tree) {
+    std::vector<std::pair<uint8_t, hid::report_decoder::field_kind>> reports;
+    for (const auto& f : tree.fields()) {
+        const std::pair key{f.report_id, f.kind};
+        if (std::ranges::find(reports, key) == reports.end()) reports.push_back(key);
+    }
+    return reports;
+}
+
+} // namespace
+
+int main(int, char* argv[]) {
+    try {
+        const options opts = parse_options(argv);
+        std::println(stderr, "report_columns kernel: {}",
+            hid::report_columns::best_kernel() == hid::report_columns::kernel::avx2 ? "avx2" : "baseline");
+        auto run = [&](std::string name, std::size_t bytes, std::size_t items, const std::function<void()>& op) {
+            if (name.find(opts.filter) == std::string::npos) return;
+            print_result(measure(std::move(name), bytes, items, opts.min_time, op));
+        };
+
+        for (const corpus_entry& entry : corpus()) {
+            const std::span<const uint8_t> bytes = entry.bytes;
+            const std::size_t items = count_items(bytes);
+
+            // Items per second counts descriptor items consumed
+            run(std::format("parse/{}", entry.name), bytes.size(), items, [&] {
+                keep(hid::report_descriptor_tree::parse(bytes));
+            });
+
+            // Per-report decoder tables for every report the descriptor declares; items are fields
+            const auto tree = hid::report_descriptor_tree::parse(bytes);
+            const auto reports = reports_of(tree);
+            run(std::format("index/{}", entry.name), bytes.size(), tree.fields().size(), [&] {
+                for (const auto& [id, kind] : reports) {
+                    keep(hid::report_decoder::compile(tree, id, kind));
+                }
+            });
+
+            // A batch of generated copies of the widest input report, decoded one
+            // report at a time, then into columns; items are values
+            hid::report_decoder decoder;
+            for (const auto& [id, kind] : reports) {
+                if (kind != hid::report_decoder::field_kind::input) continue;
+                auto d = hid::report_decoder::compile(tree, id, kind);
+                if (d.max_values() > decoder.max_values()) decoder = std::move(d);
+            }
+            if (decoder.max_values() > 0) {
+                const std::size_t stride = decoder.report_bytes();
+                constexpr std::size_t batch_rows = 4096;
+                std::vector<uint8_t> batch(batch_rows * stride);
+                uint32_t x = 0x9E3779B9;
+                for (uint8_t& b : batch) b = static_cast<uint8_t>((x = x * 1664525 + 1013904223) >> 24);
+                const std::size_t values = batch_rows * decoder.max_values();
+                std::vector<hid::report_decoder::value> out(decoder.max_values());
+                run(std::format("decode_rows/{}", entry.name), batch.size(), values, [&] {
+                    for (std::size_t r = 0; r < batch_rows; ++r) {
+                        keep(decoder.decode(std::span(batch).subspan(r * stride, stride), out));
+                    }
+                });
+                // decode_columns runs the kernel picked for this CPU; the baseline
+                // kernel is measured next to it whenever that is not the baseline
+                hid::report_columns columns(decoder);
+                run(std::format("decode_columns/{}", entry.name), batch.size(), values, [&] {
+                    columns.decode(batch, stride);
+                    keep(columns.rows());
+                });
+                if (columns.active_kernel() != hid::report_columns::kernel::baseline) {
+                    columns.use_kernel(hid::report_columns::kernel::baseline);
+                    run(std::format("decode_columns_baseline/{}", entry.name), batch.size(), values, [&] {
+                        columns.decode(batch, stride);
+                        keep(columns.rows());
+                    });
+                }
+            }
+
+            run(std::format("dump/{}", entry.name), bytes.size(), items, [&] {
+                keep(hid::descriptor_to_string(bytes));
+            });
+
+            // Hex text in the layout of .hex files; items are bytes encoded or decoded
+            std::string text;
+            run(std::format("hex_encode/{}", entry.name), bytes.size(), bytes.size(), [&] {
+                text.clear();
+                hid::hex::append(text, bytes, hid::hex::dump_layout);
+                keep(text);
+            });
+            text.clear();
+            hid::hex::append(text, bytes, hid::hex::dump_layout);
+            std::vector<uint8_t> decoded(text.size() / 2 + 1);
+            run(std::format("hex_decode/{}", entry.name), text.size(), bytes.size(), [&] {
+                keep(hid::hex::decode(text, decoded.data()));
+            });
+        }
+    } catch (const std::exception& e) {
+        std::println(stderr, "Error: {}", e.what());
+        return 1;
+    }
+    return 0;
+}
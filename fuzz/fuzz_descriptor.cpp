@@ -0,0 +1,110 @@
+/*
+ * libFuzzer target for the report descriptor parser and dumper.
+ * Usage:
+ *  xmake f --toolchain=clang && xmake build fuzz_descriptor
+ *  xmake run fuzz_descriptor [<corpus dir>] [libFuzzer options]
+ *   - Feeds every input to descriptor_to_string() and report_descriptor_tree::parse(),
+ *     then compiles a decoder and an encoder for every report the tree declares and
+ *     decodes the input itself as a payload.
+ *   - A descriptor_error is an accepted outcome; any other exception, a crash or a
+ *     sanitizer report is a finding.
+ *   - Built with -DHID_FUZZ_STANDALONE instead, the binary runs each file named on
+ *     its command line once, for reproducing a finding without libFuzzer.
+ */
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <iterator>
+#include <span>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include "hid_report_decoder.h"
+#include "hid_report_desc.h"
+#include "hid_report_desc_dump.h"
+#include "hid_report_encoder.h"
+
+namespace {
+
+// Aborts so the fuzzer records the input, like a failed assertion would
+void check(bool condition) {
+    if (!condition) std::abort();
+}
+
+void exercise_tree(const hid::report_descriptor_tree& tree, std::span<const uint8_t> payload) {
+    // Structural invariants the rest of the library relies on
+    const auto collections = tree.collections();
+    check(!collections.empty() && collections[0].parent == hid::report_descriptor_tree::npos);
+    for (std::size_t i = 1; i < collections.size(); ++i) check(collections[i].parent < i);
+    std::size_t indexed = 0;
+    for (unsigned id = 0; id < 256; ++id) {
+        for (const auto* f : tree.find_by_report_id(static_cast<uint8_t>(id))) check(f->report_id == id);
+        indexed += tree.find_by_report_id(static_cast<uint8_t>(id)).size();
+    }
+    check(indexed == tree.fields().size());
+
+    using field_kind = hid::report_descriptor_tree::field_kind;
+    for (unsigned key = 0; key < 3 * 256; ++key) {
+        const auto kind = static_cast<field_kind>(key % 3);
+        const auto layout = tree.layout(static_cast<uint8_t>(key / 3), kind);
+        uint32_t bit = 0;
+        for (const auto* f : layout.fields) {
+            check(f->kind == kind && f->bit_offset == bit);
+            bit += f->report_size_bits * f->report_count;
+        }
+        check(layout.bit_length == bit && layout.byte_length() <= tree.max_report_bytes(kind));
+    }
+
+    std::array<bool, 3 * 256> compiled{};
+    std::vector<hid::report_decoder::value> values;
+    for (const auto& f : tree.fields()) {
+        check(f.collection < collections.size());
+        const auto usages = tree.usages(f);
+        if (!usages.empty()) check(usages.contains(usages[0]) && usages.contains(usages.back()));
+
+        // Once per report
+        if (std::exchange(compiled[static_cast<std::size_t>(f.kind) * 256 + f.report_id], true)) continue;
+        const auto decoder = hid::report_decoder::compile(tree, f.report_id, f.kind);
+        values.resize(decoder.max_values());
+        check(decoder.decode(payload, values) <= values.size());
+        if (f.kind == field_kind::input) continue;
+        const auto encoder = hid::report_encoder::compile(tree, f.report_id, f.kind);
+        std::vector<uint8_t> report(encoder.report_bytes());
+        // resolve() scans every slot, so only the first few are set
+        for (const auto& s : encoder.slots().first(std::min<std::size_t>(encoder.slots().size(), 16))) {
+            const hid::report_encoder::setting st{s.usage_page, s.usage, 1};
+            try {
+                encoder.encode(report, encoder.resolve(std::span(&st, 1)));
+            } catch (const std::runtime_error&) {
+                // Usages outside an array's logical range are refused, as documented
+            }
+        }
+    }
+}
+
+} // namespace
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, std::size_t size) {
+    const std::span<const uint8_t> bytes(data, size);
+    (void)hid::descriptor_to_string(bytes);
+    try {
+        exercise_tree(hid::report_descriptor_tree::parse(bytes), bytes);
+    } catch (const hid::descriptor_error&) {
+    }
+    return 0;
+}
+
+#ifdef HID_FUZZ_STANDALONE
+int main(int, char* argv[]) {
+    for (char** arg = &argv[1]; *arg; ++arg) {
+        std::ifstream in(*arg, std::ios::binary);
+        const std::vector<uint8_t> input{std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>()};
+        LLVMFuzzerTestOneInput(input.data(), input.size());
+    }
+    return 0;
+}
+#endif
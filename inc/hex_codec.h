@@ -0,0 +1,47 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string>
+#include <string_view>
+
+namespace hid::hex {
+
+// Text layout of an encoded byte sequence. Byte i is written as
+//   [separator] prefix XX suffix ['\n']
+// where the separator is omitted before the first byte and at line starts,
+// and the newline follows every line_bytes-th byte (never if 0).
+struct layout {
+    std::string_view prefix = {};
+    std::string_view suffix = {};
+    std::string_view separator = {};
+    std::size_t line_bytes = 0;
+};
+
+// "XX XX ... XX \n" with 16 bytes per line, as used by hex dumps and hex files
+inline constexpr layout dump_layout{.suffix = " ", .line_bytes = 16};
+// " XX XX XX", appended after a line header
+inline constexpr layout inline_layout{.prefix = " "};
+// "0xXX, 0xXX", as in C array initialisers
+inline constexpr layout c_array_layout{.prefix = "0x", .separator = ", "};
+
+std::size_t encoded_size(std::size_t n, const layout& l) noexcept;
+
+// Writes exactly encoded_size(bytes.size(), l) characters to out and returns
+// the end of the written range.
+char* encode(std::span<const uint8_t> bytes, char* out, const layout& l) noexcept;
+
+// Appends the encoding to out with a single resize.
+void append(std::string& out, std::span<const uint8_t> bytes, const layout& l);
+
+struct decode_result {
+    std::size_t size = 0;           // bytes written to out
+    std::string_view bad_token = {}; // first token that is not a hex byte, empty on success
+};
+
+// Parses whitespace/comma separated tokens of one or two hex digits, each
+// optionally prefixed with 0x. out must hold text.size() / 2 + 1 bytes.
+decode_result decode(std::string_view text, uint8_t* out) noexcept;
+
+} // namespace hid::hex
@@ -0,0 +1,110 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <span>
+
+namespace hid {
+
+// Binary capture file:
+//  header   { magic "HIDCAP\0\1", version, flags, clock, descriptor size } (24 bytes)
+//  raw HID report descriptor, zero-padded to 8 bytes
+//  records  { timestamp_ns (u64), size (u32), kind (u8), 3 reserved } (16 bytes)
+//           followed by the report bytes as read from hidraw, zero-padded to 8 bytes
+// All integers are little-endian. A truncated trailing record is ignored on read.
+
+enum class capture_clock : uint32_t { realtime = 0, monotonic_raw = 1 };
+
+// Direction of a recorded report
+enum class record_kind : uint8_t { input = 0, output = 1, feature_get = 2, feature_set = 3 };
+
+struct capture_record {
+    uint64_t timestamp_ns;
+    record_kind kind;
+    std::span<const uint8_t> data; // report ID byte first if the device uses report IDs
+};
+
+// Appends records through a large userspace buffer, so the capture loop issues
+// one write() per megabyte rather than per report.
+class capture_writer
+{
+public:
+    static constexpr std::size_t buffer_capacity = 1 << 20;
+
+    capture_writer(const std::filesystem::path& path, std::span<const uint8_t> descriptor,
+        bool uses_report_ids, capture_clock clock = capture_clock::realtime);
+    ~capture_writer();
+
+    capture_writer(const capture_writer&) = delete;
+    capture_writer& operator=(const capture_writer&) = delete;
+
+    void append(uint64_t timestamp_ns, std::span<const uint8_t> report, record_kind kind = record_kind::input);
+    void flush();
+
+    uint64_t records() const noexcept { return nrecords; }
+    uint64_t bytes_written() const noexcept { return nbytes + used; }
+
+private:
+    void put(const void* data, std::size_t size);
+
+    int fd = -1;
+    std::unique_ptr<uint8_t[]> buffer;
+    std::size_t used = 0;
+    uint64_t nbytes = 0;
+    uint64_t nrecords = 0;
+};
+
+// Read-only memory-mapped view of a capture file. Records are decoded in place;
+// every span handed out points into the mapping.
+class capture_reader
+{
+public:
+    class iterator
+    {
+    public:
+        using value_type = capture_record;
+        using difference_type = std::ptrdiff_t;
+
+        iterator() = default;
+
+        capture_record operator*() const noexcept;
+        iterator& operator++() noexcept;
+        iterator operator++(int) noexcept { iterator tmp = *this; ++*this; return tmp; }
+        bool operator==(const iterator& other) const noexcept { return pos == other.pos; }
+
+    private:
+        friend class capture_reader;
+        iterator(const uint8_t* pos, const uint8_t* end) noexcept;
+
+        const uint8_t* pos = nullptr;
+        const uint8_t* end = nullptr;
+    };
+
+    explicit capture_reader(const std::filesystem::path& path);
+    ~capture_reader();
+
+    capture_reader(const capture_reader&) = delete;
+    capture_reader& operator=(const capture_reader&) = delete;
+
+    std::span<const uint8_t> descriptor() const noexcept { return desc; }
+    bool uses_report_ids() const noexcept { return report_ids; }
+    capture_clock clock() const noexcept { return clk; }
+    std::size_t file_size() const noexcept { return size; }
+
+    iterator begin() const noexcept { return {first_record, map_end()}; }
+    iterator end() const noexcept { return {map_end(), map_end()}; }
+
+private:
+    const uint8_t* map_end() const noexcept { return data + size; }
+
+    const uint8_t* data = nullptr;
+    std::size_t size = 0;
+    std::span<const uint8_t> desc;
+    const uint8_t* first_record = nullptr;
+    bool report_ids = false;
+    capture_clock clk = capture_clock::realtime;
+};
+
+} // namespace hid
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <cstddef>
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <filesystem>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <string>
+#include <unordered_map>
+
+#include "hid_report_desc.h"
+
+namespace hid {
+
+// 64-bit non-cryptographic hash of raw descriptor bytes. The value is part of
+// the on-disk cache format and must stay stable across versions and hosts.
+uint64_t descriptor_hash(std::span<const uint8_t> bytes) noexcept;
+
+// Compact JSON object members (no braces) describing a parsed descriptor:
+//   "collections":N,"fields":N,"report_ids":[...],"applications":["PPPP:UUUU",...]
+std::string descriptor_summary(const report_descriptor_tree& tree);
+
+// Per-descriptor scan results, computed once per distinct descriptor and kept
+// in memory and, if a directory is given, in dir/<hash>.txt:
+//   hidcache 1 <descriptor size>
+//   <descriptor_summary()>
+//   <descriptor_to_string() text>
+// lookup() may be called from several threads; concurrent lookups of the same
+// descriptor parse it once while the others wait for the result.
+class descriptor_cache
+{
+public:
+    enum class origin : uint8_t { parsed, disk, memory };
+
+    struct entry {
+        std::size_t descriptor_size = 0;
+        std::string summary;
+        std::filesystem::path dump_path; // empty without a cache directory
+        origin from = origin::parsed;
+    };
+
+    // Without a directory, results are only shared within this object.
+    explicit descriptor_cache(std::optional<std::filesystem::path> dir = std::nullopt);
+
+    // Returns the entry for bytes, parsing and dumping the descriptor only if
+    // neither memory nor disk has it. Parse errors are rethrown to every caller.
+    entry lookup(std::span<const uint8_t> bytes);
+
+    // Default location: $XDG_CACHE_HOME/hidtool/descriptors or ~/.cache/hidtool/descriptors
+    static std::optional<std::filesystem::path> default_dir();
+
+private:
+    struct slot {
+        entry value;
+        std::exception_ptr error;
+        bool ready = false;
+    };
+
+    entry load(std::span<const uint8_t> bytes, uint64_t hash) const;
+
+    std::optional<std::filesystem::path> dir;
+    std::mutex mutex;
+    std::condition_variable ready_cv;
+    std::unordered_map<uint64_t, slot> memo;
+};
+
+} // namespace hid
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <utility>
+
+#include "hidraw.h"
+#include "hid_report_desc.h"
+
+namespace hid {
+
+// An opened hidraw device together with its report descriptor, fetched and
+// parsed at most once on first use.
+class device_session
+{
+public:
+    using field_kind = report_descriptor_tree::field_kind;
+
+    explicit device_session(hidraw::device dev) noexcept
+        : dev_(std::move(dev))
+    {}
+
+    device_session(const device_session&) = delete;
+    device_session& operator=(const device_session&) = delete;
+    device_session(device_session&&) noexcept = default;
+    device_session& operator=(device_session&&) noexcept = default;
+
+    hidraw::device& device() noexcept { return dev_; }
+    const hidraw::device& device() const noexcept { return dev_; }
+
+    const hidraw::descriptor& descriptor();
+    const report_descriptor_tree& tree();
+
+    // Payload size in bytes (report ID byte excluded) of the given report,
+    // 0 if the descriptor declares no such report.
+    std::size_t report_size(uint8_t report_id, field_kind kind) {
+        return tree().layout(report_id, kind).byte_length();
+    }
+
+    // Largest payload of any report of the given kind
+    std::size_t max_report_size(field_kind kind) {
+        return tree().max_report_bytes(kind);
+    }
+
+    // Whether reports carry a report ID byte; if not, reads start with the payload.
+    bool uses_report_ids() {
+        return tree().uses_report_ids();
+    }
+
+    // Buffer framed with report_id and sized for the report's payload
+    hidraw::report_buffer make_report_buffer(uint8_t report_id, field_kind kind) {
+        return hidraw::report_buffer(report_id, report_size(report_id, kind));
+    }
+
+private:
+    hidraw::device dev_;
+    std::optional<hidraw::descriptor> desc_;
+    std::optional<report_descriptor_tree> tree_;
+};
+
+} // namespace hid
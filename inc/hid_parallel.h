@@ -0,0 +1,51 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace hid {
+
+// Default cap on worker threads. The work this is used for (device ioctls,
+// descriptor parsing) is dominated by waiting on slow devices, so the cap is
+// set well above the core count.
+inline constexpr std::size_t default_max_workers = 32;
+
+// Calls fn(i) for every i in [0, n) on up to max_workers threads, the calling
+// thread included, and returns once all calls have finished. Indices are handed
+// out in order, so callers merge results by writing to slot i of a pre-sized
+// vector. If any call throws, remaining indices are skipped and the first
+// exception is rethrown after all workers have stopped.
+template<typename Fn>
+void parallel_for(std::size_t n, Fn&& fn, std::size_t max_workers = default_max_workers) {
+    std::atomic<std::size_t> next{0};
+    std::exception_ptr error;
+    std::mutex error_mutex;
+
+    auto work = [&] {
+        for (std::size_t i; (i = next.fetch_add(1, std::memory_order_relaxed)) < n;) {
+            try {
+                fn(i);
+            } catch (...) {
+                std::lock_guard lock(error_mutex);
+                if (!error) error = std::current_exception();
+                next.store(n, std::memory_order_relaxed);
+            }
+        }
+    };
+
+    const std::size_t workers = std::min(n, std::max<std::size_t>(max_workers, 1));
+    {
+        std::vector<std::jthread> threads;
+        threads.reserve(workers > 0 ? workers - 1 : 0);
+        for (std::size_t t = 1; t < workers; ++t) threads.emplace_back(work);
+        work();
+    }
+    if (error) std::rethrow_exception(error);
+}
+
+} // namespace hid
@@ -0,0 +1,97 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+
+#include "hid_report_decoder.h"
+
+namespace hid {
+
+// Struct-of-arrays decoding of many reports of one ID, for offline analysis
+// of captures. Every slot of a compiled decoder becomes a column of the
+// narrowest integer type that holds its values, and each column is filled by
+// one strided pass over the batch. Array slots hold the raw logical value;
+// map it to a usage through the decoder's usage list.
+class report_columns
+{
+public:
+    enum class type : uint8_t { u8, i8, u16, i16, u32, i32 };
+
+    // Builds of the same extraction loops. avx2 is compiled with the AVX2
+    // target on x86-64 only and picked at run time, so no -march is needed;
+    // hidbench measures it against baseline.
+    enum class kernel : uint8_t { baseline, avx2 };
+
+    struct column {
+        uint32_t bit_offset; // within each report
+        uint8_t  bit_width;
+        type     t;
+        std::size_t storage_offset; // bytes into the column storage
+    };
+
+    // Lays out one column per slot of decoder.
+    explicit report_columns(const report_decoder& decoder);
+
+    // Decodes rows reports of stride bytes each, stored back to back, and
+    // replaces the previous contents. stride must cover the decoder's
+    // report_bytes(). The batch is cut into chunks of chunk_rows rows, which
+    // are spread across up to max_workers threads.
+    void decode(std::span<const uint8_t> reports, std::size_t stride, std::size_t max_workers = 1);
+
+    std::size_t rows() const noexcept { return nrows; }
+    std::span<const column> columns() const noexcept { return cols; }
+
+    // Values of column c; throws std::invalid_argument unless T is its type.
+    template<typename T>
+    std::span<const T> values(std::size_t c) const {
+        if (cols[c].t != type_of<T>()) throw std::invalid_argument("Column type mismatch");
+        return {reinterpret_cast<const T*>(storage.get() + cols[c].storage_offset), nrows};
+    }
+
+    // Single value of any column type, for formatting
+    int64_t at(std::size_t c, std::size_t row) const noexcept;
+
+    // Whether the running CPU can execute k, and the fastest kernel it can
+    static bool supports(kernel k) noexcept;
+    static kernel best_kernel() noexcept;
+
+    // decode() starts out with best_kernel(); benchmarks pick one explicitly.
+    // Throws std::invalid_argument if the CPU does not support k.
+    void use_kernel(kernel k);
+    kernel active_kernel() const noexcept { return active; }
+
+    // Rows per unit of work handed to a thread
+    static constexpr std::size_t chunk_rows = 16384;
+
+private:
+    template<typename T>
+    static constexpr type type_of() noexcept {
+        if constexpr (std::is_same_v<T, uint8_t>) return type::u8;
+        else if constexpr (std::is_same_v<T, int8_t>) return type::i8;
+        else if constexpr (std::is_same_v<T, uint16_t>) return type::u16;
+        else if constexpr (std::is_same_v<T, int16_t>) return type::i16;
+        else if constexpr (std::is_same_v<T, uint32_t>) return type::u32;
+        else {
+            static_assert(std::is_same_v<T, int32_t>, "Column types are 8, 16 or 32-bit integers");
+            return type::i32;
+        }
+    }
+
+    void reserve(std::size_t rows);
+    void decode_rows(const uint8_t* reports, std::size_t total_bytes, std::size_t stride,
+        std::size_t first_row, std::size_t rows) noexcept;
+
+    std::vector<column> cols;
+    std::size_t min_stride;
+    std::unique_ptr<std::byte[]> storage;
+    std::size_t capacity = 0;
+    std::size_t nrows = 0;
+    kernel active = best_kernel();
+};
+
+} // namespace hid
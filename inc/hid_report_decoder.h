@@ -0,0 +1,64 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include "hid_report_desc.h"
+
+namespace hid {
+
+// Extracts field values from raw report payloads. The field layout of one
+// report is flattened once at compile time into an array of slots, one per
+// reported value, so decoding is a shift/mask/sign-extend loop that never
+// allocates.
+class report_decoder
+{
+public:
+    using field_kind = report_descriptor_tree::field_kind;
+
+    struct slot {
+        uint32_t bit_offset = 0;  // from the first payload byte (report ID excluded)
+        uint8_t  bit_width = 0;   // 1..32
+        bool     is_signed = false;
+        bool     is_array = false; // value is an index into the field's usages
+        uint16_t usage_page = 0;
+        uint32_t usage = 0;       // variable slots: the usage of this value
+        uint32_t range_first = 0; // array slots: usage ranges within the decoder pool
+        uint32_t range_count = 0;
+        int32_t  logical_min = 0;
+    };
+
+    struct value {
+        uint16_t usage_page;
+        uint32_t usage;
+        int64_t  value;
+        uint32_t slot;
+    };
+
+    report_decoder() = default;
+
+    static report_decoder compile(const report_descriptor_tree& tree, uint8_t report_id,
+        field_kind kind = field_kind::input);
+
+    // Decodes one payload into out, which must hold at least max_values()
+    // entries, and returns the number of values written. Array slots whose
+    // index lies outside the usage list (i.e. "no usage") are skipped, and
+    // slots beyond the end of a short payload are not reported.
+    std::size_t decode(std::span<const uint8_t> payload, std::span<value> out) const noexcept;
+
+    std::size_t max_values() const noexcept { return slots_.size(); }
+    std::size_t report_bits() const noexcept { return report_bits_; }
+    std::size_t report_bytes() const noexcept { return (report_bits_ + 7) / 8; }
+    uint8_t report_id() const noexcept { return report_id_; }
+    std::span<const slot> slots() const noexcept { return slots_; }
+
+private:
+    std::vector<slot> slots_;
+    std::vector<usage_range> ranges_;
+    std::size_t report_bits_ = 0;
+    uint8_t report_id_ = 0;
+};
+
+} // namespace hid
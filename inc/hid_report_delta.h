@@ -0,0 +1,63 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include "hid_report_decoder.h"
+
+namespace hid {
+
+// Change detection for streams of input reports. Many devices resend the same
+// report over and over; this keeps the last report of every report ID so that
+// repeats can be dropped before formatting or capture, with a full keyframe
+// per ID every keyframe interval so a reader joining late still sees state.
+class report_delta
+{
+public:
+    // Keyframe intervals are measured on a steady clock, so wall-clock steps
+    // neither hold back keyframes nor send them early.
+    using clock = std::chrono::steady_clock;
+    using value = report_decoder::value;
+
+    enum class verdict : uint8_t {
+        repeat,   // identical to the last report of its ID
+        changed,  // differs from the last report of its ID
+        keyframe, // first of its ID, or the keyframe interval has passed
+    };
+
+    // A zero interval sends only the first report of every ID in full.
+    explicit report_delta(std::chrono::milliseconds keyframe_interval) noexcept
+        : keyframe_interval(keyframe_interval)
+    {}
+
+    // Compares payload with the last report of report_id and remembers it.
+    // now is a clock::now() reading taken when the report was handled.
+    verdict check(uint8_t report_id, std::span<const uint8_t> payload, clock::time_point now);
+
+    // Writes to out the decoded values of a report that differ from those of
+    // the previous report of its ID, and remembers values for the next call.
+    // Variable fields are compared slot by slot; array fields as a set of
+    // usages, with usages no longer present written with value 0. out must
+    // hold 2 * decoder.max_values() entries.
+    std::size_t changed_values(const report_decoder& decoder, std::span<const value> values, std::span<value> out);
+
+    uint64_t repeats() const noexcept { return nrepeats; }
+
+private:
+    struct last_report {
+        std::vector<uint8_t> bytes;
+        std::vector<value> values;
+        clock::time_point keyframe;
+        bool seen = false;
+    };
+
+    std::array<last_report, 256> last;
+    std::chrono::milliseconds keyframe_interval;
+    uint64_t nrepeats = 0;
+};
+
+} // namespace hid
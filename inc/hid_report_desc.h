@@ -1,16 +1,137 @@
 #pragma once
 
+#include <cstddef>
 #include <cstdint>
-#include <vector>
+#include <array>
+#include <iterator>
 #include <span>
 #include <memory>
-#include <unordered_map>
+#include <stdexcept>
+#include <string>
 
 namespace hid {
 
+// Thrown by report_descriptor_tree::parse() for a descriptor that is cut off
+// mid-item or goes beyond one of its parse_limits.
+class descriptor_error : public std::runtime_error
+{
+public:
+    enum class reason : uint8_t { truncated_item, collection_depth, push_depth, fields, usages, report_size };
+
+    descriptor_error(reason why, std::size_t offset, const std::string& message)
+        : std::runtime_error(message), why_(why), offset_(offset)
+    {}
+
+    reason why() const noexcept { return why_; }
+    // Byte offset of the offending item within the descriptor
+    std::size_t offset() const noexcept { return offset_; }
+
+private:
+    reason why_;
+    std::size_t offset_;
+};
+
+// Inclusive run of usages [min, max]; a single Usage item is a run of one.
+struct usage_range {
+    uint32_t min = 0;
+    uint32_t max = 0;
+
+    uint64_t size() const noexcept { return uint64_t{max} - min + 1; }
+    bool contains(uint32_t u) const noexcept { return min <= u && u <= max; }
+};
+
+// Usages of one field, stored as ranges rather than expanded values.
+// Iteration and indexing follow declaration order; contains() binary-searches
+// a sorted, merged copy of the same ranges.
+class usage_set
+{
+public:
+    class iterator
+    {
+    public:
+        using value_type = uint32_t;
+        using difference_type = std::ptrdiff_t;
+
+        iterator() = default;
+
+        uint32_t operator*() const noexcept { return value; }
+        iterator& operator++() noexcept {
+            if (value != range->max) {
+                ++value;
+            } else if (++range != last) {
+                value = range->min;
+            } else {
+                value = 0;
+            }
+            return *this;
+        }
+        iterator operator++(int) noexcept { iterator tmp = *this; ++*this; return tmp; }
+        bool operator==(const iterator& other) const noexcept = default;
+
+    private:
+        friend class usage_set;
+        iterator(const usage_range* r, const usage_range* last) noexcept
+            : range(r), last(last), value(r != last ? r->min : 0)
+        {}
+
+        const usage_range* range = nullptr;
+        const usage_range* last = nullptr;
+        uint32_t value = 0;
+    };
+
+    usage_set() = default;
+    usage_set(std::span<const usage_range> ranges, std::span<const usage_range> sorted, uint64_t count) noexcept
+        : ranges_(ranges), sorted_(sorted), count_(count)
+    {}
+
+    uint64_t size() const noexcept { return count_; }
+    bool empty() const noexcept { return count_ == 0; }
+    std::span<const usage_range> ranges() const noexcept { return ranges_; }
+
+    // i-th usage in declaration order, i < size(); O(number of ranges)
+    uint32_t operator[](uint64_t i) const noexcept {
+        for (const usage_range& r : ranges_) {
+            if (i < r.size()) return static_cast<uint32_t>(r.min + i);
+            i -= r.size();
+        }
+        return 0;
+    }
+
+    uint32_t back() const noexcept { return ranges_.back().max; }
+
+    // O(log n) in the number of ranges
+    bool contains(uint32_t u) const noexcept {
+        std::size_t lo = 0, hi = sorted_.size();
+        while (lo < hi) {
+            const std::size_t mid = lo + (hi - lo) / 2;
+            if (sorted_[mid].max < u) lo = mid + 1;
+            else hi = mid;
+        }
+        return lo < sorted_.size() && sorted_[lo].min <= u;
+    }
+
+    iterator begin() const noexcept { return {ranges_.data(), ranges_.data() + ranges_.size()}; }
+    iterator end() const noexcept {
+        const usage_range* last = ranges_.data() + ranges_.size();
+        return {last, last};
+    }
+
+private:
+    std::span<const usage_range> ranges_;
+    std::span<const usage_range> sorted_;
+    uint64_t count_ = 0;
+};
+
 // Parsed HID Report Descriptor as a tree structure.
+//
+// All nodes live in flat arrays carved out of a single arena allocation:
+// collections in pre-order (index 0 is the implicit root), fields in
+// descriptor order, and one usage pool shared by every field. Links between
+// them are indices, so the tree is cheap to move and to traverse.
 class report_descriptor_tree {
 public:
+    static constexpr uint32_t npos = UINT32_MAX;
+
     struct report_field_flags {
         // Flags from Input/Output/Feature data byte
         // Bit meanings per HID spec:
@@ -39,7 +160,12 @@ public:
         field_kind kind;
         uint8_t report_id = 0; // 0 if none
         uint16_t usage_page = 0; // current usage page
-        std::vector<uint32_t> usages; // collected usages for this field
+        uint32_t collection = 0;  // index of the enclosing collection
+        uint32_t range_first = 0; // collected usages as ranges: see usages()
+        uint32_t range_count = 0;
+        uint32_t sorted_count = 0; // merged ranges used for lookups
+        uint32_t bit_offset = 0;   // within its report's payload (report ID byte excluded)
+        uint64_t usage_count = 0;  // total number of usages
         uint32_t report_size_bits = 0; // per item report size (bits)
         uint32_t report_count = 0;     // per item report count
         int32_t logical_min = 0;
@@ -56,21 +182,85 @@ public:
         uint8_t type = 0;
         uint16_t usage_page = 0;
         uint32_t usage = 0; // main usage of the collection if set
-        std::vector<report_field> fields; // input/output/feature defined under this collection
-        std::vector<std::unique_ptr<collection_node>> children;
+        uint32_t parent = npos;       // npos for the root
+        uint32_t first_child = npos;
+        uint32_t next_sibling = npos;
     };
 
-    // Parse from raw descriptor bytes
+    // Bounds on what parse() accepts, so that a hostile descriptor cannot make
+    // it run away. Every item is read twice and adds at most one collection,
+    // field or usage range, so memory is linear in the descriptor size and time
+    // is too, apart from sorting the usage ranges of each field. The defaults
+    // are far beyond real devices; report_bytes matches the Linux HID core.
+    struct parse_limits {
+        std::size_t collection_depth = 32; // open collections below the implicit root
+        std::size_t push_depth = 16;       // Push items without a matching Pop
+        std::size_t fields = 4096;         // Input, Output and Feature items
+        uint64_t usages = 1 << 20;         // of all fields, Usage Minimum/Maximum ranges expanded
+        std::size_t report_bytes = 16384;  // of each report, summed over its fields; at most 2^29
+    };
+
+    // Parse from raw descriptor bytes with a single allocation. Throws
+    // descriptor_error for a truncated item or a descriptor beyond the limits.
     static report_descriptor_tree parse(std::span<const uint8_t> bytes);
+    static report_descriptor_tree parse(std::span<const uint8_t> bytes, const parse_limits& limits);
+
+    // Placement of one report's fields, laid out back to back in descriptor
+    // order; each field's position is its bit_offset.
+    struct report_layout {
+        std::span<const report_field* const> fields;
+        uint32_t bit_length = 0; // payload, report ID byte excluded
+
+        uint32_t byte_length() const noexcept { return (bit_length + 7) / 8; }
+        bool empty() const noexcept { return fields.empty(); }
+    };
+
+    // Layout of a report, computed at parse time; empty if the descriptor
+    // declares no such report.
+    report_layout layout(uint8_t report_id, field_kind kind) const noexcept {
+        const std::size_t key = std::size_t{report_id} * 3 + static_cast<std::size_t>(kind);
+        const auto fields = index_.subspan(index_offsets_[key], index_offsets_[key + 1] - index_offsets_[key]);
+        if (fields.empty()) return {};
+        const report_field& last = *fields.back();
+        return {fields, last.bit_offset + last.report_size_bits * last.report_count};
+    }
+
+    // Largest payload in bytes of any report of a kind
+    std::size_t max_report_bytes(field_kind kind) const noexcept {
+        return max_report_bytes_[static_cast<std::size_t>(kind)];
+    }
+
+    // Whether any field sets a report ID, so that reports start with an ID byte
+    bool uses_report_ids() const noexcept { return uses_report_ids_; }
+
+    // Find all fields bound to a specific report ID: inputs, then outputs,
+    // then features, each in descriptor order
+    std::span<const report_field* const> find_by_report_id(uint8_t report_id) const noexcept {
+        const std::size_t key = std::size_t{report_id} * 3;
+        return index_.subspan(index_offsets_[key], index_offsets_[key + 3] - index_offsets_[key]);
+    }
 
-    // Find all fields bound to a specific report ID
-    std::vector<const report_field*> find_by_report_id(uint8_t report_id) const;
+    const collection_node& root() const noexcept { return collections_[0]; }
+    std::span<const collection_node> collections() const noexcept { return collections_; }
+    std::span<const report_field> fields() const noexcept { return fields_; }
 
-    const collection_node& root() const { return *root_; }
+    usage_set usages(const report_field& f) const noexcept {
+        return usage_set(
+            usage_pool_.subspan(f.range_first, f.range_count),
+            sorted_pool_.subspan(f.range_first, f.sorted_count),
+            f.usage_count);
+    }
 
 private:
-    std::unique_ptr<collection_node> root_;
-    std::unordered_map<uint8_t, std::vector<const report_field*>> index_by_report_id_;
+    std::unique_ptr<std::byte[]> arena_;
+    std::span<collection_node> collections_;
+    std::span<report_field> fields_;
+    std::span<usage_range> usage_pool_;
+    std::span<usage_range> sorted_pool_;
+    std::span<const report_field*> index_;
+    std::array<uint32_t, 3 * 256 + 1> index_offsets_{}; // keyed by report ID * 3 + kind
+    std::array<uint32_t, 3> max_report_bytes_{};
+    bool uses_report_ids_ = false;
 };
 
 } // namespace hid
@@ -1,12 +1,51 @@
 #pragma once
 
+#include <algorithm>
 #include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <iosfwd>
+#include <iterator>
+#include <optional>
 #include <string>
+#include <string_view>
 #include <span>
+#include <utility>
 
 namespace hid {
 
 // Human-readable dump of raw HID report descriptor bytes.
 std::string descriptor_to_string(std::span<const uint8_t> bytes);
 
+// Receives the dump in chunks of a few kilobytes, each valid only during the call.
+using dump_sink = std::function<void(std::string_view chunk)>;
+
+// Same text as descriptor_to_string(), streamed to a sink so the full dump is
+// never held in memory. Write errors on FILE*/fd sinks throw std::system_error;
+// a stream that fails, or fails to flush at the end, throws std::runtime_error.
+void write_descriptor(std::span<const uint8_t> bytes, const dump_sink& sink);
+void write_descriptor(std::span<const uint8_t> bytes, std::FILE* out);
+void write_descriptor(std::span<const uint8_t> bytes, int fd);
+void write_descriptor(std::span<const uint8_t> bytes, std::ostream& out);
+
+template<std::output_iterator<char> Out>
+Out write_descriptor_to(std::span<const uint8_t> bytes, Out out) {
+    write_descriptor(bytes, [&out](std::string_view chunk) { out = std::ranges::copy(chunk, std::move(out)).out; });
+    return out;
+}
+
+// Names from the HID Usage Tables, with a hexadecimal fallback for unknown values.
+std::string usage_page_name(uint16_t page);
+std::string usage_name(uint16_t page, uint32_t usage);
+void append_usage_page_name(std::string& out, uint16_t page);
+void append_usage_name(std::string& out, uint16_t page, uint32_t usage);
+
+// Table lookups only: empty if the value has no name. Views point into static storage.
+std::string_view find_usage_page_name(uint16_t page) noexcept;
+std::string_view find_usage_name(uint16_t page, uint32_t usage) noexcept;
+
+// Inverse of the names above, ignoring case: a known usage name or "Button <n>"
+// gives its (page, usage); any other name gives nullopt.
+std::optional<std::pair<uint16_t, uint32_t>> find_usage_by_name(std::string_view name) noexcept;
+
 } // namespace hid
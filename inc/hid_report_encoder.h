@@ -0,0 +1,80 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <vector>
+
+#include "hid_report_desc.h"
+
+namespace hid {
+
+// Packs field values into raw report payloads; the mirror of report_decoder.
+// The field layout of one report is flattened once at compile time into an
+// array of slots with precomputed bit offsets. Settings are resolved to slots
+// up front, so encoding is a mask-and-store loop that never allocates.
+class report_encoder
+{
+public:
+    using field_kind = report_descriptor_tree::field_kind;
+
+    struct slot {
+        uint32_t bit_offset = 0;  // from the first payload byte (report ID excluded)
+        uint8_t  bit_width = 0;   // 1..32
+        bool     is_array = false; // value is an index into the field's usages
+        uint16_t usage_page = 0;
+        uint32_t usage = 0;       // variable slots: the usage of this value
+        uint32_t range_first = 0; // array slots: usage ranges within the encoder pool
+        uint32_t range_count = 0;
+        uint32_t field = 0;       // slots of one array field share this index
+        int32_t  logical_min = 0;
+        int32_t  logical_max = 0;
+    };
+
+    // A usage and the value to give it. For array fields a non-zero value
+    // selects the usage and zero leaves it out.
+    struct setting {
+        uint16_t usage_page;
+        uint32_t usage;
+        int64_t  value;
+    };
+
+    // A setting bound to its slot, with the value already in logical range
+    struct assignment {
+        uint32_t slot;
+        int64_t  value;
+    };
+
+    report_encoder() = default;
+
+    static report_encoder compile(const report_descriptor_tree& tree, uint8_t report_id,
+        field_kind kind = field_kind::output);
+
+    // Binds settings to slots. Repeating a usage fills its next slot, both for
+    // variable fields whose trailing values share the last usage and for array
+    // fields, whose slots are taken in order. Values outside the logical range
+    // are clamped. Throws std::runtime_error for a usage the report does not
+    // carry or more settings of a usage than it has slots.
+    std::vector<assignment> resolve(std::span<const setting> settings) const;
+
+    // Writes the assignments into payload, which holds report_bytes() bytes;
+    // bits of slots without an assignment are left as they are.
+    void encode(std::span<uint8_t> payload, std::span<const assignment> values) const noexcept;
+
+    // Usage page of the first slot carrying usage, for usages given without one
+    std::optional<uint16_t> find_usage_page(uint32_t usage) const noexcept;
+
+    std::size_t report_bits() const noexcept { return report_bits_; }
+    std::size_t report_bytes() const noexcept { return (report_bits_ + 7) / 8; }
+    uint8_t report_id() const noexcept { return report_id_; }
+    std::span<const slot> slots() const noexcept { return slots_; }
+
+private:
+    std::vector<slot> slots_;
+    std::vector<usage_range> ranges_;
+    std::size_t report_bits_ = 0;
+    uint8_t report_id_ = 0;
+};
+
+} // namespace hid
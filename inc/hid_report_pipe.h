@@ -0,0 +1,91 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <span>
+#include <thread>
+
+#include "hidraw_monitor.h"
+
+namespace hid {
+
+// Hands input reports from the monitor thread to a consumer thread through a
+// preallocated lock-free single-producer/single-consumer ring, so formatting
+// and file writes never hold up the reads that keep the kernel's 64-report
+// hidraw queue from overflowing. A report that finds the ring full is dropped
+// and counted as an overrun rather than blocking the reader.
+class report_pipe
+{
+public:
+    using report_event = hidraw::monitor::report_event;
+    using consumer = std::function<void(const report_event&)>;
+
+    // Allocates capacity (rounded up to a power of two) slots of report_size
+    // bytes and starts the consumer thread with SIGINT and SIGTERM blocked, so
+    // they keep reaching the monitor loop.
+    report_pipe(std::size_t capacity, std::size_t report_size, consumer fn);
+    ~report_pipe();
+
+    report_pipe(const report_pipe&) = delete;
+    report_pipe& operator=(const report_pipe&) = delete;
+
+    // Producer side: copies the report (truncated to report_size) and its
+    // timestamp into the ring. Returns false if the ring was full, or without
+    // copying anything once the consumer has failed.
+    bool push(const report_event& ev) noexcept;
+
+    // True once the consumer has thrown; close() then rethrows its exception.
+    // Lets the producer stop early instead of feeding a dead consumer.
+    bool failed() const noexcept { return consumer_failed.load(std::memory_order_acquire); }
+
+    // Lets the consumer drain every report pushed so far and joins it.
+    // Rethrows the first exception the consumer threw; reports after it are
+    // discarded unconsumed. Must not be followed by push().
+    void close();
+
+    // Producer-side counters; read them from the producer thread or after close().
+    uint64_t pushed() const noexcept { return npushed; }
+    uint64_t overruns() const noexcept { return noverruns; }
+    // Peak occupancy, measured against the tail as last seen by the producer,
+    // so it never under-reports.
+    std::size_t high_water() const noexcept { return peak; }
+    std::size_t capacity() const noexcept { return mask + 1; }
+
+private:
+    void run() noexcept;
+
+    static constexpr uint64_t closed_bit = uint64_t{1} << 63;
+    static constexpr std::size_t cache_line = 64;
+
+    struct slot_header {
+        hidraw::monitor::clock::time_point timestamp;
+        std::size_t source;
+        std::size_t size;
+    };
+
+    std::size_t mask;
+    std::size_t slot_size;
+    std::unique_ptr<slot_header[]> headers;
+    std::unique_ptr<std::uint8_t[]> storage;
+    consumer fn;
+    std::exception_ptr error;
+    std::atomic<bool> consumer_failed{false};
+
+    // Producer-owned
+    alignas(cache_line) std::atomic<uint64_t> head{0}; // next slot to fill; closed_bit once closed
+    uint64_t tail_seen = 0;
+    uint64_t npushed = 0;
+    uint64_t noverruns = 0;
+    std::size_t peak = 0;
+
+    // Consumer-owned
+    alignas(cache_line) std::atomic<uint64_t> tail{0}; // next slot to consume
+
+    std::thread worker;
+};
+
+} // namespace hid
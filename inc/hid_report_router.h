@@ -0,0 +1,81 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <span>
+#include <vector>
+
+#include "hidraw_monitor.h"
+#include "hid_device_session.h"
+#include "hid_stats.h"
+
+namespace hid {
+
+// Demultiplexes input reports of one device by their leading report ID.
+// Reports whose ID has no sink are dropped after a single table lookup,
+// before any formatting or capture work.
+class report_router
+{
+public:
+    struct routed_report {
+        const hidraw::monitor::report_event& event;
+        uint8_t report_id;                 // 0 for devices without report IDs
+        std::span<const uint8_t> payload;  // report ID byte stripped
+        bool short_read;                   // fewer bytes than the descriptor declares
+    };
+
+    using sink = std::function<void(const routed_report&)>;
+
+    // Takes report ID usage and per-ID input sizes from the session's descriptor.
+    explicit report_router(device_session& session);
+
+    // Registers a sink and returns its handle for route().
+    std::size_t add_sink(sink fn);
+
+    // Sends reports with report_id to a sink; a later call replaces the route.
+    // Throws std::invalid_argument if the descriptor has no such input report.
+    void route(uint8_t report_id, std::size_t sink_handle);
+
+    // Buffer size that holds the largest input report, report ID byte included
+    std::size_t max_report_size() const noexcept { return max_size + (numbered ? 1 : 0); }
+
+    bool uses_report_ids() const noexcept { return numbered; }
+
+    void dispatch(const hidraw::monitor::report_event& ev) {
+        std::span<const uint8_t> payload = ev.data;
+        uint8_t id = 0;
+        if (numbered) {
+            if (payload.empty()) {
+                ++dropped_count;
+                stats::count_dropped();
+                return;
+            }
+            id = payload[0];
+            payload = payload.subspan(1);
+        }
+        stats::count_report(id);
+        const uint8_t slot = routes[id];
+        if (slot == 0) {
+            ++dropped_count;
+            stats::count_dropped();
+            return;
+        }
+        const bool short_read = payload.size() < sizes[id];
+        if (short_read) stats::count_short_read();
+        sinks[slot - 1]({ev, id, payload, short_read});
+    }
+
+    uint64_t dropped() const noexcept { return dropped_count; }
+
+private:
+    std::array<uint8_t, 256> routes{}; // sink index + 1, 0 = drop
+    std::array<uint32_t, 256> sizes{}; // declared input payload size per ID
+    std::vector<sink> sinks;
+    std::size_t max_size = 0;
+    uint64_t dropped_count = 0;
+    bool numbered = false;
+};
+
+} // namespace hid
@@ -0,0 +1,144 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <string>
+#include <thread>
+
+namespace hid::stats {
+
+// Counters and latency histograms for the streaming, batch and bench paths.
+// They are compiled in only when HIDTOOL_COUNTERS is defined (xmake f
+// --counters=y); otherwise every hook below is an empty inline function and
+// scoped_timer takes no clock readings, so the hot loops are unchanged.
+#ifdef HIDTOOL_COUNTERS
+inline constexpr bool enabled = true;
+#else
+inline constexpr bool enabled = false;
+#endif
+
+// Timed operations, one histogram each
+enum class op : uint8_t { read, write, feature_get, feature_set, decode };
+inline constexpr std::size_t op_count = 5;
+
+// Log2 histogram of durations: bucket i counts samples in [2^i, 2^(i+1)) ns,
+// the last bucket everything longer.
+struct histogram {
+    static constexpr std::size_t bucket_count = 40;
+
+    std::array<std::atomic<uint64_t>, bucket_count> buckets{};
+    std::atomic<uint64_t> count{0};
+    std::atomic<uint64_t> sum_ns{0};
+    std::atomic<uint64_t> max_ns{0};
+
+    void record(uint64_t ns) noexcept {
+        const std::size_t b = ns == 0 ? 0 : std::min<std::size_t>(std::bit_width(ns) - 1, bucket_count - 1);
+        buckets[b].fetch_add(1, std::memory_order_relaxed);
+        count.fetch_add(1, std::memory_order_relaxed);
+        sum_ns.fetch_add(ns, std::memory_order_relaxed);
+        uint64_t seen = max_ns.load(std::memory_order_relaxed);
+        while (ns > seen && !max_ns.compare_exchange_weak(seen, ns, std::memory_order_relaxed)) {}
+    }
+};
+
+struct registry {
+    std::array<std::atomic<uint64_t>, 256> reports_by_id{}; // input reports received
+    std::atomic<uint64_t> bytes_written{0};  // to output and capture files
+    std::atomic<uint64_t> short_reads{0};    // fewer bytes than the descriptor declares
+    std::atomic<uint64_t> dropped{0};        // reports of IDs nobody asked for
+    std::atomic<uint64_t> overruns{0};       // reports lost to a full report_pipe
+    std::array<histogram, op_count> latency{};
+};
+
+registry& global() noexcept;
+
+// --- Hot-path hooks ---
+
+inline void count_report(uint8_t report_id) noexcept {
+    if constexpr (enabled) global().reports_by_id[report_id].fetch_add(1, std::memory_order_relaxed);
+}
+inline void add_bytes_written(std::size_t n) noexcept {
+    if constexpr (enabled) global().bytes_written.fetch_add(n, std::memory_order_relaxed);
+}
+inline void count_short_read() noexcept {
+    if constexpr (enabled) global().short_reads.fetch_add(1, std::memory_order_relaxed);
+}
+inline void count_dropped() noexcept {
+    if constexpr (enabled) global().dropped.fetch_add(1, std::memory_order_relaxed);
+}
+inline void count_overrun() noexcept {
+    if constexpr (enabled) global().overruns.fetch_add(1, std::memory_order_relaxed);
+}
+
+// Records the lifetime of the object into the histogram of an operation
+class scoped_timer
+{
+public:
+    explicit scoped_timer(op o) noexcept : o(o) {
+        if constexpr (enabled) start = std::chrono::steady_clock::now();
+    }
+    ~scoped_timer() {
+        if constexpr (enabled) {
+            const auto ns = std::chrono::nanoseconds(std::chrono::steady_clock::now() - start).count();
+            global().latency[static_cast<std::size_t>(o)].record(static_cast<uint64_t>(ns));
+        }
+    }
+
+    scoped_timer(const scoped_timer&) = delete;
+    scoped_timer& operator=(const scoped_timer&) = delete;
+
+private:
+    op o;
+    std::chrono::steady_clock::time_point start{}; // left unset, and so optimised out, without counters
+};
+
+// --- Reporting ---
+
+enum class format : uint8_t { text, json, prometheus };
+
+// Per-ID report counts at one moment, for deriving rates between two dumps
+struct snapshot {
+    std::chrono::steady_clock::time_point taken;
+    std::array<uint64_t, 256> reports_by_id{};
+};
+snapshot take_snapshot() noexcept;
+
+// Appends the current values of the registry. With since, the text format
+// also gives the reports per second of each ID since that snapshot.
+void append(std::string& out, format fmt, const snapshot* since = nullptr);
+
+// Publishes the registry while a command runs: every interval as text on
+// stderr, and on each connection to a Unix socket in the chosen format.
+// The final values go to stderr when the reporter is destroyed.
+class reporter
+{
+public:
+    struct options {
+        std::chrono::milliseconds interval{0}; // 0: no periodic dump
+        std::optional<std::filesystem::path> socket_path;
+        format socket_format = format::prometheus;
+    };
+
+    explicit reporter(options opts);
+    ~reporter();
+
+    reporter(const reporter&) = delete;
+    reporter& operator=(const reporter&) = delete;
+
+private:
+    void run() noexcept;
+
+    options opts;
+    int listen_fd = -1;
+    int wake_fds[2] = {-1, -1}; // self-pipe: written to stop the thread
+    std::thread worker;
+};
+
+} // namespace hid::stats
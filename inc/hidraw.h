@@ -2,10 +2,15 @@
 
 #include <cstddef>
 #include <cstdint>
+#include <chrono>
+#include <optional>
 #include <string>
 #include <filesystem>
 #include <utility>
 #include <span>
+#include <array>
+#include <memory>
+#include <vector>
 
 namespace hidraw {
 
@@ -55,7 +60,11 @@ public:
     ~info() = default;
 
     std::string to_string() const;
-    
+
+    std::uint32_t bus_type() const noexcept { return bustype; }
+    std::uint16_t vendor_id() const noexcept { return static_cast<std::uint16_t>(vendor); }
+    std::uint16_t product_id() const noexcept { return static_cast<std::uint16_t>(product); }
+
 private:
     friend class device;
     std::uint32_t bustype = 0;
@@ -63,13 +72,133 @@ private:
     std::int16_t product = 0;
 };
 
+// Report ID byte followed by the report payload, the framing expected by
+// write(), read() and the feature ioctls. Payloads up to inline_capacity bytes
+// are stored inside the object; larger ones allocate once on construction.
+class report_buffer
+{
+public:
+    static constexpr std::size_t inline_capacity = 63;
+
+    report_buffer() = default;
+
+    report_buffer(std::uint8_t report_id, std::size_t payload_size)
+        : heap(payload_size > inline_capacity ? std::make_unique<std::uint8_t[]>(payload_size + 1) : nullptr)
+        , payload_size(payload_size)
+    {
+        data()[0] = report_id;
+    }
+
+    // The moved-from buffer is left empty: no payload, only the report ID byte
+    report_buffer(report_buffer&& other) noexcept
+        : inline_storage(other.inline_storage)
+        , heap(std::move(other.heap))
+        , payload_size(std::exchange(other.payload_size, 0))
+    {}
+
+    report_buffer& operator=(report_buffer&& other) noexcept {
+        inline_storage = other.inline_storage;
+        heap = std::move(other.heap);
+        payload_size = std::exchange(other.payload_size, 0);
+        return *this;
+    }
+
+    std::uint8_t report_id() const noexcept { return data()[0]; }
+    void set_report_id(std::uint8_t id) noexcept { data()[0] = id; }
+
+    std::size_t size() const noexcept { return payload_size; }
+
+    // Payload without the report ID byte
+    std::span<std::uint8_t> payload() noexcept { return {data() + 1, payload_size}; }
+    std::span<const std::uint8_t> payload() const noexcept { return {data() + 1, payload_size}; }
+
+    // Report ID byte and payload, as passed to the kernel
+    std::span<std::uint8_t> bytes() noexcept { return {data(), payload_size + 1}; }
+    std::span<const std::uint8_t> bytes() const noexcept { return {data(), payload_size + 1}; }
+
+private:
+    std::uint8_t* data() noexcept { return heap ? heap.get() : inline_storage.data(); }
+    const std::uint8_t* data() const noexcept { return heap ? heap.get() : inline_storage.data(); }
+
+    std::array<std::uint8_t, inline_capacity + 1> inline_storage{};
+    std::unique_ptr<std::uint8_t[]> heap;
+    std::size_t payload_size = 0;
+};
+
+// Fixed-capacity FIFO of reports filled by device::drain(). Every slot holds
+// up to report_size bytes and the time its read returned; all storage is
+// allocated on construction.
+class report_ring
+{
+public:
+    using clock = std::chrono::system_clock;
+
+    report_ring() = default;
+    report_ring(std::size_t capacity, std::size_t report_size)
+        : storage(std::make_unique<std::uint8_t[]>(capacity * report_size))
+        , lengths(std::make_unique<std::size_t[]>(capacity))
+        , timestamps(std::make_unique<clock::time_point[]>(capacity))
+        , cap(capacity)
+        , slot_size(report_size)
+    {}
+
+    std::size_t capacity() const noexcept { return cap; }
+    std::size_t report_size() const noexcept { return slot_size; }
+    std::size_t size() const noexcept { return count; }
+    bool empty() const noexcept { return count == 0; }
+    bool full() const noexcept { return count == cap; }
+
+    // Oldest report, as many bytes as read() returned; ring must not be empty
+    std::span<const std::uint8_t> front() const noexcept {
+        return {storage.get() + head * slot_size, lengths[head]};
+    }
+
+    clock::time_point front_timestamp() const noexcept { return timestamps[head]; }
+
+    void pop() noexcept {
+        head = head + 1 == cap ? 0 : head + 1;
+        --count;
+    }
+
+    void clear() noexcept { head = count = 0; }
+
+private:
+    friend class device;
+
+    // Slot the next report is read into; ring must not be full
+    std::span<std::uint8_t> back_slot() noexcept {
+        const std::size_t tail = (head + count) % cap;
+        return {storage.get() + tail * slot_size, slot_size};
+    }
+
+    void push(std::size_t length, clock::time_point timestamp) noexcept {
+        const std::size_t tail = (head + count) % cap;
+        lengths[tail] = length;
+        timestamps[tail] = timestamp;
+        ++count;
+    }
+
+    std::unique_ptr<std::uint8_t[]> storage;
+    std::unique_ptr<std::size_t[]> lengths;
+    std::unique_ptr<clock::time_point[]> timestamps;
+    std::size_t cap = 0;
+    std::size_t slot_size = 0;
+    std::size_t head = 0;
+    std::size_t count = 0;
+};
+
+enum class open_mode : std::uint8_t {
+    blocking,
+    nonblocking, // O_NONBLOCK: read() throws EAGAIN instead of waiting
+};
+
 class device
 {
 public:
     device() = default;
 
-    explicit device(const std::filesystem::path& path) {
-        this->open(path);
+    explicit device(const std::filesystem::path& path, open_mode mode = open_mode::blocking) {
+        this->open(path, mode);
     }
 
     ~device() { this->close(); }
@@ -79,6 +208,7 @@ public:
 
     device(device&& other) noexcept
         : fd(std::exchange(other.fd, -1))
+        , current_mode(other.current_mode)
     {}
 
     device& operator=(device&& other) noexcept {
@@ -88,12 +218,16 @@ public:
 
     void swap(device& other) noexcept {
         std::ranges::swap(fd, other.fd);
+        std::ranges::swap(current_mode, other.current_mode);
     }
 
     int native_handle() const noexcept { return fd; }
     bool valid() const noexcept { return fd != -1; }
 
-    void open(const std::filesystem::path& path);
+    void open(const std::filesystem::path& path, open_mode mode = open_mode::blocking);
+    void set_mode(open_mode mode);
+    // As set at open() or by set_mode(), without a syscall
+    open_mode mode() const noexcept { return current_mode; }
     void close();
     std::size_t report_desc_size() const;
     descriptor report_desc() const;
@@ -101,13 +235,36 @@ public:
     std::string raw_name() const;
     std::string addr() const;
 
+    // All report I/O takes the report ID in byte 0 followed by the payload.
     void write(std::span<const std::uint8_t> data);
     std::size_t read(std::span<std::uint8_t> data);
     void feature_get(std::span<std::uint8_t> data);
     void feature_set(std::span<const std::uint8_t> data);
 
+    void write(const report_buffer& buf) { write(buf.bytes()); }
+    std::size_t read(report_buffer& buf) { return read(buf.bytes()); }
+    void feature_get(report_buffer& buf) { feature_get(buf.bytes()); }
+    void feature_set(const report_buffer& buf) { feature_set(buf.bytes()); }
+
+    // Waits up to timeout for an input report, in either open mode; nullopt
+    // if none arrived in time. A negative timeout waits indefinitely.
+    std::optional<std::size_t> read_for(std::span<std::uint8_t> data, std::chrono::milliseconds timeout);
+    std::optional<std::size_t> try_read(std::span<std::uint8_t> data) {
+        return read_for(data, std::chrono::milliseconds::zero());
+    }
+
+    // Reads every report already queued by the kernel into ring without
+    // waiting, until the queue is empty or the ring is full. Returns the
+    // number of reports added. On a non-blocking device this costs one read()
+    // per report plus one final EAGAIN.
+    std::size_t drain(report_ring& ring);
+
 private:
     int fd = -1;
+    open_mode current_mode = open_mode::blocking;
 };
 
+// Paths of all hidraw nodes in dir, ordered by node number.
+std::vector<std::filesystem::path> enumerate_devices(const std::filesystem::path& dir = "/dev");
+
 } // namespace hidraw
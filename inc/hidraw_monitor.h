@@ -0,0 +1,116 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <chrono>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <span>
+#include <vector>
+
+#include "hidraw.h"
+
+namespace hidraw {
+
+// Event loop that waits for input reports on any number of opened devices
+// until SIGINT or SIGTERM is delivered.
+class monitor
+{
+public:
+    using clock = report_ring::clock;
+
+    // epoll drains each ready device with read(); io_uring keeps a poll with a
+    // chain of reads linked behind it per device and reaps completions in
+    // batches.
+    enum class backend : std::uint8_t { epoll, io_uring };
+
+    struct report_event {
+        std::size_t source;                // index returned by add()
+        clock::time_point timestamp;       // taken when the read of this report returned
+        std::span<const std::uint8_t> data; // valid only during the callback
+    };
+
+    using report_callback = std::function<void(const report_event&)>;
+    using disconnect_callback = std::function<void(std::size_t source)>;
+
+    // An io_uring request falls back to epoll if the kernel does not provide it.
+    explicit monitor(backend preferred = backend::epoll);
+    ~monitor();
+
+    monitor(const monitor&) = delete;
+    monitor& operator=(const monitor&) = delete;
+
+    backend active_backend() const noexcept { return uring ? backend::io_uring : backend::epoll; }
+
+    // Reports queued on a device are drained in batches of up to this many per wakeup.
+    static constexpr std::size_t batch_capacity = 64;
+
+    // Registers a device; reports are drained into a ring of buffer_size-byte
+    // slots owned by the monitor and reused for every wakeup. With epoll, open
+    // the device with open_mode::nonblocking to avoid a poll() per report while
+    // draining; the io_uring backend switches the device to it. Reports of one
+    // source are always delivered in the order the device queued them.
+    // The device must stay open until it is removed or the monitor is
+    // destroyed. Source indices are never reused, so callers may keep
+    // per-source state in a vector.
+    std::size_t add(device& dev, std::size_t buffer_size);
+
+    // Stops watching a source; may be called from inside a callback.
+    void remove(std::size_t source);
+
+    // Watches an arbitrary readable fd (e.g. a hotplug_watcher) from the same loop.
+    void watch(int fd, std::function<void()> on_readable);
+
+    // Runs until SIGINT/SIGTERM. Both signals are blocked for the calling thread
+    // while running and are restored on return.
+    // A device that hangs up or fails to read is removed and reported through
+    // on_disconnect; without a handler the error is thrown instead.
+    void run(const report_callback& on_report, const disconnect_callback& on_disconnect = {});
+
+    class uring_engine;
+
+private:
+    struct source {
+        device* dev;
+        report_ring ring;
+    };
+
+    struct fd_watch {
+        int fd;
+        std::function<void()> on_readable;
+    };
+
+    int epfd = -1;
+    std::unique_ptr<uring_engine> uring;
+    std::vector<std::optional<source>> sources;
+    std::vector<fd_watch> watches;
+};
+
+// Reports /dev/hidraw* nodes appearing and disappearing, via inotify.
+class hotplug_watcher
+{
+public:
+    enum class change : std::uint8_t { added, removed };
+    using change_callback = std::function<void(change, const std::filesystem::path&)>;
+
+    explicit hotplug_watcher(const std::filesystem::path& dir = "/dev");
+    ~hotplug_watcher();
+
+    hotplug_watcher(const hotplug_watcher&) = delete;
+    hotplug_watcher& operator=(const hotplug_watcher&) = delete;
+
+    int native_handle() const noexcept { return fd; }
+
+    // Drains pending inotify events. Nodes are reported as added both when
+    // created and when their attributes change, since udev fixes up
+    // permissions after creation; callers should ignore paths already open.
+    void dispatch(const change_callback& on_change);
+
+private:
+    std::filesystem::path dir;
+    int fd = -1;
+};
+
+} // namespace hidraw
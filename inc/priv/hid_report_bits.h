@@ -0,0 +1,48 @@
+// Internal header: bit-level access to report payloads and extended usage
+// handling shared by the report decoder and encoder.  Not part of the public API.
+#pragma once
+
+#include <bit>
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+
+namespace hid {
+namespace detail {
+
+// Usages wider than 16 bits carry their own usage page (HID 1.11 §6.2.2.8).
+static constexpr uint16_t usage_page_of(uint32_t usage, uint16_t page) noexcept {
+	return usage > 0xFFFF ? static_cast<uint16_t>(usage >> 16) : page;
+}
+
+static constexpr uint32_t usage_id_of(uint32_t usage) noexcept {
+	return usage > 0xFFFF ? (usage & 0xFFFF) : usage;
+}
+
+// Little-endian load of up to 8 bytes starting at byte, zero-filled past size.
+static inline uint64_t load_le64(const uint8_t* data, std::size_t size, std::size_t byte) noexcept {
+	uint64_t v = 0;
+	if (byte + sizeof(v) <= size) {
+		std::memcpy(&v, data + byte, sizeof(v));
+		if constexpr (std::endian::native == std::endian::big) v = std::byteswap(v);
+		return v;
+	}
+	for (std::size_t i = 0; byte + i < size; ++i)
+		v |= static_cast<uint64_t>(data[byte + i]) << (8 * i);
+	return v;
+}
+
+// Replaces width (1..32) bits at bit_offset with the low bits of value,
+// leaving neighbouring bits intact. Bits past size are dropped.
+static inline void store_bits(uint8_t* data, std::size_t size, uint32_t bit_offset, uint8_t width, uint64_t value) noexcept {
+	const std::size_t byte = bit_offset >> 3;
+	const unsigned shift = bit_offset & 7;
+	const uint64_t mask = ((uint64_t{1} << width) - 1) << shift;
+	const uint64_t v = (load_le64(data, size, byte) & ~mask) | ((value << shift) & mask);
+	const std::size_t nbytes = (shift + width + 7) / 8;
+	for (std::size_t i = 0; i < nbytes && byte + i < size; ++i)
+		data[byte + i] = static_cast<uint8_t>(v >> (8 * i));
+}
+
+} // namespace detail
+} // namespace hid
@@ -3,7 +3,9 @@
 #pragma once
 
 #include <cstdint>
+#include <cstddef>
 #include <algorithm>
+#include <array>
 
 namespace hid {
 namespace detail {
@@ -13,22 +15,30 @@ namespace detail {
 // ════════════════════════════════════════════════════════════════════════════
 
 struct item {
+	uint8_t  prefix = 0; // raw prefix byte; 0xFE for long items
 	uint8_t  size = 0; // 0,1,2,4 — or 0xFF for long items
 	uint8_t  type = 0; // 0=Main, 1=Global, 2=Local, 3=Reserved
 	uint8_t  tag  = 0;
 	uint32_t data = 0;
+	bool     truncated = false; // the descriptor ends inside the item's data
 };
 
 static inline item parse_item(const uint8_t*& p, const uint8_t* end) noexcept {
 	if (p >= end) return {};
 	uint8_t prefix = *p++;
 	item it{};
+	it.prefix = prefix;
 	if (prefix == 0xFE) { // long item
-		if (p + 2 > end) return {};
+		it.size = 0xFF; it.type = 3; it.tag = 0xFF;
+		if (end - p < 2) {
+			p = end;
+			it.truncated = true;
+			return it;
+		}
 		uint8_t data_size = *p++;
 		(void)*p++;
-		it.size = 0xFF; it.type = 3; it.tag = 0xFF;
-		p = std::min(p + data_size, end);
+		it.truncated = end - p < data_size;
+		p = it.truncated ? end : p + data_size;
 		return it;
 	}
 	uint8_t bSizeCode = prefix & 0x03;
@@ -37,13 +47,32 @@ static inline item parse_item(const uint8_t*& p, const uint8_t* end) noexcept {
 	it.tag  = (prefix >> 4) & 0x0F;
 	uint32_t v = 0;
 	for (uint8_t i = 0; i < it.size; ++i) {
-		if (p >= end) break;
+		if (p >= end) {
+			it.truncated = true;
+			break;
+		}
 		v |= static_cast<uint32_t>(*p++) << (8 * i);
 	}
 	it.data = v;
 	return it;
 }
 
+// Expands a table keyed on (type, tag) into one slot per prefix byte, so the
+// per-item lookup is a single index. The two size bits select the same entry;
+// prefixes without an entry (including 0xFE, long items) hold T{}.
+template<typename T, typename Entry, std::size_t N, typename Proj>
+consteval std::array<T, 256> make_prefix_table(const std::array<Entry, N>& entries, Proj proj) {
+	std::array<T, 256> t{};
+	for (const Entry& e : entries) {
+		for (uint8_t size = 0; size < 4; ++size) {
+			T& slot = t[(e.tag << 4) | (e.type << 2) | size];
+			if (slot != T{}) throw "duplicate (type, tag) entry";
+			slot = proj(e);
+		}
+	}
+	return t;
+}
+
 static constexpr int32_t sign_extend(uint32_t v, uint8_t size) noexcept {
 	switch (size) {
 		case 1: return static_cast<int8_t>(static_cast<uint8_t>(v));
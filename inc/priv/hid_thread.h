@@ -0,0 +1,38 @@
+// Internal header: helper threads that leave signal handling to the main loop.
+// Not part of the public API.
+#pragma once
+
+#include <pthread.h>
+#include <signal.h>
+
+#include <thread>
+#include <utility>
+
+namespace hid {
+namespace detail {
+
+// Starts a thread with SIGINT and SIGTERM blocked, so that they keep being
+// delivered to the thread running hidraw::monitor. A thread inherits the
+// signal mask in effect when it is created, so the mask is swapped around
+// the creation rather than set from inside the new thread, which would leave
+// a window for the signal to land there.
+template<typename Fn>
+std::thread start_signal_blocked_thread(Fn&& fn) {
+	::sigset_t block, old;
+	::sigemptyset(&block);
+	::sigaddset(&block, SIGINT);
+	::sigaddset(&block, SIGTERM);
+	::pthread_sigmask(SIG_BLOCK, &block, &old);
+	std::thread t;
+	try {
+		t = std::thread(std::forward<Fn>(fn));
+	} catch (...) {
+		::pthread_sigmask(SIG_SETMASK, &old, nullptr);
+		throw;
+	}
+	::pthread_sigmask(SIG_SETMASK, &old, nullptr);
+	return t;
+}
+
+} // namespace detail
+} // namespace hid
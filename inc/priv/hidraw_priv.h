@@ -4,8 +4,20 @@
 
 #include "hidraw.h" // IWYU pragma: export
 
+#include <cerrno>
+#include <format>
+#include <system_error>
+#include <type_traits>
+#include <utility>
+
 namespace hidraw {
 
+template<typename... Args>
+[[noreturn]] static inline void throw_system_error(
+    std::type_identity_t<std::format_string<Args...>> fmt, Args&&... args) noexcept(false) {
+    throw std::system_error(errno, std::system_category(), std::format(fmt, std::forward<Args>(args)...));
+}
+
 struct report_descriptor_head {
     ::__u32 size;
 };
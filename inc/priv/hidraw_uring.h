@@ -0,0 +1,107 @@
+// Internal header: io_uring backend of hidraw::monitor. Not part of the public API.
+#pragma once
+
+#include <linux/io_uring.h>
+
+#include "hidraw_monitor.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <utility>
+#include <vector>
+
+namespace hidraw {
+
+// Every source has one chain in flight: a POLL_ADD hard-linked to
+// reads_per_wakeup IORING_OP_READ_FIXED requests, each into its own slot of a
+// single registered buffer arena. Linked requests run strictly one after
+// another, so a source never has more than one read in flight and its reports
+// complete in the order hidraw queued them. Sources are non-blocking, so the
+// reads past the last queued report fail fast with -EAGAIN instead of parking
+// io-wq workers, and the chain is re-armed once all of it has completed.
+// Completions are reaped in batches with one io_uring_enter() per batch.
+// Watched fds and the signalfd are serviced with re-armed one-shot
+// IORING_OP_POLL_ADDs. Rings are driven through raw syscalls; liburing is not
+// required.
+class monitor::uring_engine
+{
+public:
+    static constexpr std::size_t reads_per_wakeup = 8;
+    static constexpr std::size_t arena_size = std::size_t{4} << 20;
+    static constexpr unsigned queue_entries = 512;
+    // Worst case per source: its chain, plus the cancel of its poll once the
+    // source is removed
+    static constexpr std::size_t cqes_per_source = reads_per_wakeup + 2;
+
+    // Throws std::system_error if the kernel lacks io_uring (or it is
+    // disabled) or refuses the buffer registration; callers fall back to epoll.
+    uring_engine();
+    ~uring_engine();
+
+    uring_engine(const uring_engine&) = delete;
+    uring_engine& operator=(const uring_engine&) = delete;
+
+    std::size_t add(device& dev, std::size_t buffer_size);
+    void remove(std::size_t source);
+    void watch(int fd, std::function<void()> on_readable);
+    void run(int signal_fd, const report_callback& on_report, const disconnect_callback& on_disconnect);
+
+private:
+    struct source {
+        int fd;
+        std::size_t offset;    // first slot in the arena
+        std::size_t slot_size; // bytes per slot, 64-byte aligned
+        std::size_t buffer_size;
+        std::uint32_t in_flight = 0; // completions still due from the chain
+        bool removed = false;
+    };
+
+    struct fd_watch {
+        int fd;
+        std::function<void()> on_readable;
+    };
+
+    ::io_uring_sqe& next_sqe();
+    void submit_chain(std::size_t index);
+    void submit_poll(int fd, std::uint64_t token);
+    void submit_cancel(std::uint64_t target);
+    // Submits queued SQEs and waits for at least wait_nr completions
+    void enter(unsigned wait_nr);
+    // CQ entries the registered sources, watches and signal poll can need at once
+    std::size_t worst_case_cqes() const noexcept;
+    void release_source(std::size_t index);
+    void close() noexcept;
+
+    std::optional<std::size_t> allocate(std::size_t size);
+    void deallocate(std::size_t offset, std::size_t size);
+
+    int ring_fd = -1;
+    void* ring_map = nullptr;
+    std::size_t ring_map_size = 0;
+    ::io_uring_sqe* sqes = nullptr;
+    std::size_t sqes_size = 0;
+
+    unsigned* sq_head = nullptr;
+    unsigned* sq_tail = nullptr;
+    unsigned sq_mask = 0;
+    unsigned sq_entries = 0;
+    unsigned* cq_head = nullptr;
+    unsigned* cq_tail = nullptr;
+    unsigned cq_mask = 0;
+    unsigned cq_entries = 0;
+    ::io_uring_cqe* cqes = nullptr;
+
+    unsigned local_tail = 0;     // SQEs written, published on enter()
+    unsigned to_submit = 0;
+    std::size_t outstanding = 0; // requests the kernel may still complete
+
+    std::uint8_t* arena = nullptr;
+    std::vector<std::pair<std::size_t, std::size_t>> free_ranges; // (offset, size), sorted
+
+    std::vector<std::optional<source>> sources;
+    std::vector<fd_watch> watches;
+};
+
+} // namespace hidraw
@@ -0,0 +1,104 @@
+// Table-driven hex encoding and decoding shared by dumps, hex files and captures.
+#include "hex_codec.h"
+
+#include <array>
+#include <cstring>
+
+namespace hid::hex {
+
+namespace {
+
+// Two upper-case digits per byte value
+static constexpr auto digit_pairs = [] consteval {
+	constexpr std::string_view digits = "0123456789ABCDEF";
+	std::array<std::array<char, 2>, 256> t{};
+	for (std::size_t i = 0; i < t.size(); ++i)
+		t[i] = {digits[i >> 4], digits[i & 0xF]};
+	return t;
+}();
+
+constexpr uint8_t not_hex   = 0xFF;
+constexpr uint8_t delimiter = 0xFE;
+
+// Nibble value of a hex digit; delimiter for token separators; not_hex otherwise
+static constexpr auto char_class = [] consteval {
+	std::array<uint8_t, 256> t{};
+	t.fill(not_hex);
+	for (int c = '0'; c <= '9'; ++c) t[c] = static_cast<uint8_t>(c - '0');
+	for (int c = 'A'; c <= 'F'; ++c) t[c] = static_cast<uint8_t>(c - 'A' + 10);
+	for (int c = 'a'; c <= 'f'; ++c) t[c] = static_cast<uint8_t>(c - 'a' + 10);
+	for (char c : {' ', '\t', '\r', '\n', ','}) t[static_cast<uint8_t>(c)] = delimiter;
+	return t;
+}();
+
+static inline char* put(char* out, std::string_view s) noexcept {
+	if (s.empty()) return out;
+	std::memcpy(out, s.data(), s.size());
+	return out + s.size();
+}
+
+} // namespace
+
+std::size_t encoded_size(std::size_t n, const layout& l) noexcept {
+	if (n == 0) return 0;
+	const std::size_t lines = l.line_bytes ? n / l.line_bytes : 0; // newlines written
+	const std::size_t line_starts = l.line_bytes ? (n - 1) / l.line_bytes : 0; // separators skipped
+	return n * (l.prefix.size() + 2 + l.suffix.size())
+		+ (n - 1 - line_starts) * l.separator.size()
+		+ lines;
+}
+
+char* encode(std::span<const uint8_t> bytes, char* out, const layout& l) noexcept {
+	const std::size_t n = bytes.size();
+	// Fast path for the plain layouts: no per-byte branches beyond the copy
+	if (l.separator.empty() && l.line_bytes == 0) {
+		for (std::size_t i = 0; i < n; ++i) {
+			out = put(out, l.prefix);
+			std::memcpy(out, digit_pairs[bytes[i]].data(), 2);
+			out = put(out + 2, l.suffix);
+		}
+		return out;
+	}
+	for (std::size_t i = 0; i < n; ++i) {
+		const bool line_start = l.line_bytes && i % l.line_bytes == 0;
+		if (i != 0 && !line_start) out = put(out, l.separator);
+		out = put(out, l.prefix);
+		std::memcpy(out, digit_pairs[bytes[i]].data(), 2);
+		out = put(out + 2, l.suffix);
+		if (l.line_bytes && (i + 1) % l.line_bytes == 0) *out++ = '\n';
+	}
+	return out;
+}
+
+void append(std::string& out, std::span<const uint8_t> bytes, const layout& l) {
+	const std::size_t old_size = out.size();
+	const std::size_t n = encoded_size(bytes.size(), l);
+	// Return the length explicitly: libstdc++ 12 passes the grown capacity, not the requested size
+	out.resize_and_overwrite(old_size + n, [&](char* p, std::size_t) {
+		return static_cast<std::size_t>(encode(bytes, p + old_size, l) - p);
+	});
+}
+
+decode_result decode(std::string_view text, uint8_t* out) noexcept {
+	decode_result r;
+	const char* p   = text.data();
+	const char* end = p + text.size();
+	while (p < end) {
+		if (char_class[static_cast<uint8_t>(*p)] == delimiter) { ++p; continue; }
+		const char* tok = p;
+		while (p < end && char_class[static_cast<uint8_t>(*p)] != delimiter) ++p;
+		const char* digits = tok;
+		if (p - tok > 2 && tok[0] == '0' && (tok[1] == 'x' || tok[1] == 'X')) digits += 2;
+		const std::size_t len = static_cast<std::size_t>(p - digits);
+		const uint8_t hi = char_class[static_cast<uint8_t>(digits[0])];
+		const uint8_t lo = len == 2 ? char_class[static_cast<uint8_t>(digits[1])] : 0;
+		if (len == 0 || len > 2 || hi > 0xF || lo > 0xF) {
+			r.bad_token = std::string_view(tok, static_cast<std::size_t>(p - tok));
+			return r;
+		}
+		out[r.size++] = static_cast<uint8_t>(len == 2 ? (hi << 4) | lo : hi);
+	}
+	return r;
+}
+
+} // namespace hid::hex
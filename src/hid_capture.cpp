@@ -0,0 +1,208 @@
+// Binary capture files: buffered writer and memory-mapped reader.
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "hid_capture.h"
+#include "hid_stats.h"
+#include "priv/hidraw_priv.h"
+
+#include <array>
+#include <bit>
+#include <cstring>
+#include <stdexcept>
+
+namespace hid {
+
+namespace {
+
+using hidraw::throw_system_error;
+
+constexpr std::array<uint8_t, 8> capture_magic = {'H', 'I', 'D', 'C', 'A', 'P', 0, 1};
+constexpr uint32_t capture_version = 1;
+constexpr uint32_t flag_report_ids = 0x1;
+
+struct file_header {
+	std::array<uint8_t, 8> magic;
+	uint32_t version;
+	uint32_t flags;
+	uint32_t clock;
+	uint32_t descriptor_size;
+};
+static_assert(sizeof(file_header) == 24);
+
+struct record_header {
+	uint64_t timestamp_ns;
+	uint32_t size;
+	uint8_t  kind;
+	uint8_t  reserved[3];
+};
+static_assert(sizeof(record_header) == 16);
+
+static_assert(std::endian::native == std::endian::little, "capture files are written in host byte order");
+
+static constexpr std::size_t pad8(std::size_t n) noexcept { return (n + 7) & ~std::size_t{7}; }
+
+constexpr std::array<uint8_t, 8> zero_pad{};
+
+// Reads the record header at pos; false if the record does not fit before end
+static bool read_record_header(const uint8_t* pos, const uint8_t* end, record_header& h) noexcept {
+	if (static_cast<std::size_t>(end - pos) < sizeof(record_header)) return false;
+	std::memcpy(&h, pos, sizeof(h));
+	return pad8(h.size) <= static_cast<std::size_t>(end - pos) - sizeof(record_header);
+}
+
+} // namespace
+
+// ════════════════════════════════════════════════════════════════════════════
+// Writer
+// ════════════════════════════════════════════════════════════════════════════
+
+capture_writer::capture_writer(const std::filesystem::path& path, std::span<const uint8_t> descriptor,
+	bool uses_report_ids, capture_clock clock)
+	: buffer(std::make_unique_for_overwrite<uint8_t[]>(buffer_capacity))
+{
+	fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+	if (fd < 0) {
+		throw_system_error("Failed to open capture file '{}'", path.string());
+	}
+	file_header h{
+		.magic           = capture_magic,
+		.version         = capture_version,
+		.flags           = uses_report_ids ? flag_report_ids : 0,
+		.clock           = static_cast<uint32_t>(clock),
+		.descriptor_size = static_cast<uint32_t>(descriptor.size()),
+	};
+	put(&h, sizeof(h));
+	put(descriptor.data(), descriptor.size());
+	put(zero_pad.data(), pad8(descriptor.size()) - descriptor.size());
+}
+
+capture_writer::~capture_writer() {
+	try {
+		flush();
+	} catch (...) {
+		// Destructors must not throw; call flush() explicitly to observe errors.
+	}
+	::close(fd);
+}
+
+void capture_writer::append(uint64_t timestamp_ns, std::span<const uint8_t> report, record_kind kind) {
+	record_header h{
+		.timestamp_ns = timestamp_ns,
+		.size         = static_cast<uint32_t>(report.size()),
+		.kind         = static_cast<uint8_t>(kind),
+		.reserved     = {},
+	};
+	put(&h, sizeof(h));
+	put(report.data(), report.size());
+	put(zero_pad.data(), pad8(report.size()) - report.size());
+	++nrecords;
+}
+
+void capture_writer::put(const void* data, std::size_t n) {
+	if (used + n > buffer_capacity) {
+		flush();
+	}
+	if (n > buffer_capacity) {
+		// Larger than the whole buffer: bypass it
+		const auto* p = static_cast<const uint8_t*>(data);
+		while (n > 0) {
+			::ssize_t ret = ::write(fd, p, n);
+			if (ret < 0) {
+				if (errno == EINTR) continue;
+				throw_system_error("Failed to write capture file");
+			}
+			p += ret;
+			n -= static_cast<std::size_t>(ret);
+			nbytes += static_cast<std::size_t>(ret);
+			stats::add_bytes_written(static_cast<std::size_t>(ret));
+		}
+		return;
+	}
+	std::memcpy(buffer.get() + used, data, n);
+	used += n;
+}
+
+void capture_writer::flush() {
+	std::size_t done = 0;
+	while (done < used) {
+		::ssize_t ret = ::write(fd, buffer.get() + done, used - done);
+		if (ret < 0) {
+			if (errno == EINTR) continue;
+			throw_system_error("Failed to write capture file");
+		}
+		done += static_cast<std::size_t>(ret);
+	}
+	nbytes += used;
+	stats::add_bytes_written(used);
+	used = 0;
+}
+
+// ════════════════════════════════════════════════════════════════════════════
+// Reader
+// ════════════════════════════════════════════════════════════════════════════
+
+capture_reader::capture_reader(const std::filesystem::path& path) {
+	int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+	if (fd < 0) {
+		throw_system_error("Failed to open capture file '{}'", path.string());
+	}
+	struct ::stat st;
+	if (::fstat(fd, &st) < 0) {
+		::close(fd);
+		throw_system_error("Failed to stat capture file '{}'", path.string());
+	}
+	size = static_cast<std::size_t>(st.st_size);
+	if (size < sizeof(file_header)) {
+		::close(fd);
+		throw std::runtime_error(std::format("Not a capture file: {}", path.string()));
+	}
+	void* map = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+	::close(fd);
+	if (map == MAP_FAILED) {
+		throw_system_error("Failed to map capture file '{}'", path.string());
+	}
+	data = static_cast<const uint8_t*>(map);
+	::madvise(map, size, MADV_SEQUENTIAL);
+
+	file_header h;
+	std::memcpy(&h, data, sizeof(h));
+	const std::size_t records_offset = sizeof(h) + pad8(h.descriptor_size);
+	if (h.magic != capture_magic || h.version != capture_version || records_offset > size) {
+		::munmap(map, size);
+		throw std::runtime_error(std::format("Not a supported capture file: {}", path.string()));
+	}
+	desc         = {data + sizeof(h), h.descriptor_size};
+	first_record = data + records_offset;
+	report_ids   = h.flags & flag_report_ids;
+	clk          = static_cast<capture_clock>(h.clock);
+}
+
+capture_reader::~capture_reader() {
+	::munmap(const_cast<uint8_t*>(data), size);
+}
+
+capture_reader::iterator::iterator(const uint8_t* pos, const uint8_t* end) noexcept
+	: pos(pos), end(end)
+{
+	record_header h;
+	if (pos != end && !read_record_header(pos, end, h)) this->pos = end;
+}
+
+capture_record capture_reader::iterator::operator*() const noexcept {
+	record_header h;
+	std::memcpy(&h, pos, sizeof(h));
+	return {h.timestamp_ns, static_cast<record_kind>(h.kind), {pos + sizeof(h), h.size}};
+}
+
+capture_reader::iterator& capture_reader::iterator::operator++() noexcept {
+	record_header h;
+	std::memcpy(&h, pos, sizeof(h));
+	pos += sizeof(h) + pad8(h.size);
+	if (pos != end && !read_record_header(pos, end, h)) pos = end;
+	return *this;
+}
+
+} // namespace hid
@@ -0,0 +1,187 @@
+// Descriptor fingerprints and the content-addressed scan cache.
+#include <unistd.h>
+
+#include "hid_descriptor_cache.h"
+#include "hid_report_desc_dump.h"
+
+#include <array>
+#include <cstdlib>
+#include <format>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+#include <system_error>
+
+namespace hid {
+
+namespace {
+
+constexpr std::string_view cache_magic = "hidcache 1";
+
+// Final avalanche of MurmurHash3
+static constexpr uint64_t fmix64(uint64_t x) noexcept {
+	x ^= x >> 33;
+	x *= 0xFF51AFD7ED558CCD;
+	x ^= x >> 33;
+	x *= 0xC4CEB9FE1A85EC53;
+	x ^= x >> 33;
+	return x;
+}
+
+static uint64_t load_le64(const uint8_t* p, std::size_t n) noexcept {
+	uint64_t v = 0;
+	for (std::size_t i = 0; i < n; ++i) v |= uint64_t{p[i]} << (8 * i);
+	return v;
+}
+
+static std::string hash_name(uint64_t hash) {
+	return std::format("{:016x}", hash);
+}
+
+// Reads a cache file; nullopt if it is missing or does not match the descriptor
+static std::optional<std::string> read_summary(const std::filesystem::path& path, std::size_t descriptor_size) {
+	std::ifstream ifs(path);
+	std::string header, summary;
+	if (!ifs || !std::getline(ifs, header) || !std::getline(ifs, summary)) return std::nullopt;
+	if (header != std::format("{} {}", cache_magic, descriptor_size)) return std::nullopt;
+	return summary;
+}
+
+// Writes through a temporary file so concurrent scans never see a partial entry
+static void write_entry(const std::filesystem::path& path, std::span<const uint8_t> bytes, const std::string& summary) {
+	std::filesystem::path tmp = path;
+	tmp += std::format(".tmp.{}", ::getpid());
+	{
+		std::ofstream ofs(tmp, std::ios::binary | std::ios::trunc);
+		if (!ofs) return;
+		ofs << cache_magic << ' ' << bytes.size() << '\n' << summary << '\n';
+		try {
+			write_descriptor(bytes, ofs);
+		} catch (const std::runtime_error&) {
+			// A failed cache write only costs a parse next time
+			std::error_code ec;
+			std::filesystem::remove(tmp, ec);
+			return;
+		}
+	}
+	std::error_code ec;
+	std::filesystem::rename(tmp, path, ec);
+	if (ec) std::filesystem::remove(tmp, ec);
+}
+
+} // namespace
+
+uint64_t descriptor_hash(std::span<const uint8_t> bytes) noexcept {
+	const uint8_t* p = bytes.data();
+	const std::size_t n = bytes.size();
+	uint64_t h = fmix64(0x9E3779B97F4A7C15 ^ n);
+	std::size_t i = 0;
+	for (; i + 8 <= n; i += 8)
+		h = (h ^ fmix64(load_le64(p + i, 8))) * 0x9FB21C651E98DF25;
+	if (i < n)
+		h = (h ^ fmix64(load_le64(p + i, n - i))) * 0x9FB21C651E98DF25;
+	return fmix64(h);
+}
+
+std::string descriptor_summary(const report_descriptor_tree& tree) {
+	std::string s;
+	auto out = std::back_inserter(s);
+	// The root collection is synthetic and not counted
+	std::format_to(out, "\"collections\":{},\"fields\":{},\"report_ids\":[",
+		tree.collections().size() - 1, tree.fields().size());
+	std::array<bool, 256> seen{};
+	for (const auto& f : tree.fields()) seen[f.report_id] = true;
+	bool first = true;
+	for (std::size_t id = 1; id < seen.size(); ++id) {
+		if (!seen[id]) continue;
+		std::format_to(out, "{}{}", first ? "" : ",", id);
+		first = false;
+	}
+	s += "],\"applications\":[";
+	first = true;
+	const auto collections = tree.collections();
+	for (uint32_t c = collections[0].first_child; c != report_descriptor_tree::npos; c = collections[c].next_sibling) {
+		const auto& node = collections[c];
+		std::format_to(out, "{}\"{:04X}:{:04X}\"", first ? "" : ",", node.usage_page, node.usage);
+		first = false;
+	}
+	s += ']';
+	return s;
+}
+
+descriptor_cache::descriptor_cache(std::optional<std::filesystem::path> dir)
+	: dir(std::move(dir))
+{
+	if (this->dir) {
+		std::error_code ec;
+		std::filesystem::create_directories(*this->dir, ec);
+		// An unusable cache directory degrades to memory-only dedup
+		if (ec) this->dir.reset();
+	}
+}
+
+descriptor_cache::entry descriptor_cache::lookup(std::span<const uint8_t> bytes) {
+	const uint64_t hash = descriptor_hash(bytes);
+	std::unique_lock lock(mutex);
+	auto [it, inserted] = memo.try_emplace(hash);
+	slot& s = it->second;
+	if (!inserted) {
+		ready_cv.wait(lock, [&] { return s.ready; });
+		if (s.error) std::rethrow_exception(s.error);
+		// A hash collision with a different descriptor is served uncached
+		if (s.value.descriptor_size != bytes.size()) {
+			lock.unlock();
+			entry e;
+			e.descriptor_size = bytes.size();
+			e.summary = descriptor_summary(report_descriptor_tree::parse(bytes));
+			return e;
+		}
+		entry e = s.value;
+		e.from = origin::memory;
+		return e;
+	}
+
+	// Parse without holding the lock; map nodes stay put while other keys are added
+	lock.unlock();
+	entry e;
+	std::exception_ptr error;
+	try {
+		e = load(bytes, hash);
+	} catch (...) {
+		error = std::current_exception();
+	}
+	lock.lock();
+	s.value = e;
+	s.error = error;
+	s.ready = true;
+	ready_cv.notify_all();
+	if (error) std::rethrow_exception(error);
+	return e;
+}
+
+descriptor_cache::entry descriptor_cache::load(std::span<const uint8_t> bytes, uint64_t hash) const {
+	entry e;
+	e.descriptor_size = bytes.size();
+	if (dir) {
+		e.dump_path = *dir / (hash_name(hash) + ".txt");
+		if (auto summary = read_summary(e.dump_path, bytes.size())) {
+			e.summary = std::move(*summary);
+			e.from = origin::disk;
+			return e;
+		}
+	}
+	e.summary = descriptor_summary(report_descriptor_tree::parse(bytes));
+	e.from = origin::parsed;
+	if (dir) write_entry(e.dump_path, bytes, e.summary);
+	return e;
+}
+
+std::optional<std::filesystem::path> descriptor_cache::default_dir() {
+	if (const char* xdg = std::getenv("XDG_CACHE_HOME"); xdg && *xdg)
+		return std::filesystem::path(xdg) / "hidtool" / "descriptors";
+	if (const char* home = std::getenv("HOME"); home && *home)
+		return std::filesystem::path(home) / ".cache" / "hidtool" / "descriptors";
+	return std::nullopt;
+}
+
+} // namespace hid
@@ -0,0 +1,15 @@
+#include "hid_device_session.h"
+
+namespace hid {
+
+const hidraw::descriptor& device_session::descriptor() {
+    if (!desc_) desc_ = dev_.report_desc();
+    return *desc_;
+}
+
+const report_descriptor_tree& device_session::tree() {
+    if (!tree_) tree_ = report_descriptor_tree::parse(descriptor().to_bytes());
+    return *tree_;
+}
+
+} // namespace hid
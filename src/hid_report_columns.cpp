@@ -0,0 +1,215 @@
+// Columnar batch decoding of fixed-size reports.
+#include "hid_report_columns.h"
+#include "hid_parallel.h"
+#include "priv/hid_report_bits.h"
+
+#include <algorithm>
+#include <bit>
+#include <cstring>
+
+// The AVX2 kernel is a second build of the same loops with the x86-64 AVX2
+// target, picked at run time, so shipped binaries need no -march flag.
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define HID_COLUMNS_AVX2 1
+#else
+#define HID_COLUMNS_AVX2 0
+#endif
+
+namespace hid {
+
+namespace {
+
+using detail::load_le64;
+
+constexpr std::size_t column_alignment = 64;
+
+constexpr std::size_t type_size(report_columns::type t) noexcept {
+	switch (t) {
+		case report_columns::type::u8:
+		case report_columns::type::i8:  return 1;
+		case report_columns::type::u16:
+		case report_columns::type::i16: return 2;
+		case report_columns::type::u32:
+		case report_columns::type::i32: return 4;
+	}
+	return 4;
+}
+
+constexpr report_columns::type column_type(const report_decoder::slot& s) noexcept {
+	using type = report_columns::type;
+	if (s.bit_width <= 8) return s.is_signed ? type::i8 : type::u8;
+	if (s.bit_width <= 16) return s.is_signed ? type::i16 : type::u16;
+	return s.is_signed ? type::i32 : type::u32;
+}
+
+template<typename T>
+[[gnu::always_inline]] inline T load_native(const uint8_t* p) noexcept {
+	T v;
+	std::memcpy(&v, p, sizeof(v));
+	if constexpr (std::endian::native == std::endian::big && sizeof(T) > 1) v = std::byteswap(v);
+	return v;
+}
+
+// Extracts one field from rows [first, first + rows) into out[first...].
+// The field position is fixed across the batch, so the body of each loop is a
+// strided load, shift and mask with no branches. At -O3 GCC vectorises the
+// shift and mask on 128-bit vectors assembled from scalar strided loads; it
+// emits no gathers for them, so both kernels do the same work there and the
+// AVX2 one only widens some strided copies to 256 bits. Byte-aligned fields
+// as wide as their column reduce to a strided copy. Rows whose 8-byte load
+// window would run past the end of the batch take the bounds-checked path.
+template<typename T>
+[[gnu::always_inline]] inline void extract(const uint8_t* reports, std::size_t total_bytes, std::size_t stride, std::size_t first, std::size_t rows,
+	const report_columns::column& c, T* out) noexcept
+{
+	const std::size_t byte = c.bit_offset >> 3;
+	const unsigned shift = c.bit_offset & 7;
+	const unsigned width = c.bit_width;
+	const std::size_t last = first + rows;
+
+	if (shift == 0 && width == sizeof(T) * 8) {
+		// The field lies within its row, so every load is in bounds
+		for (std::size_t r = first; r < last; ++r) out[r] = load_native<T>(reports + r * stride + byte);
+		return;
+	}
+
+	std::size_t fast_last = first;
+	if (total_bytes >= byte + sizeof(uint64_t))
+		fast_last = std::clamp((total_bytes - byte - sizeof(uint64_t)) / stride + 1, first, last);
+
+	if constexpr (std::is_signed_v<T>) {
+		// Moves the field to the top and shifts back arithmetically to sign-extend it
+		const unsigned up = 64 - shift - width;
+		const unsigned down = 64 - width;
+		for (std::size_t r = first; r < fast_last; ++r) {
+			const uint64_t raw = load_native<uint64_t>(reports + r * stride + byte);
+			out[r] = static_cast<T>(static_cast<int64_t>(raw << up) >> down);
+		}
+		for (std::size_t r = fast_last; r < last; ++r) {
+			const uint64_t raw = load_le64(reports + r * stride, total_bytes - r * stride, byte);
+			out[r] = static_cast<T>(static_cast<int64_t>(raw << up) >> down);
+		}
+	} else {
+		const uint64_t mask = (uint64_t{1} << width) - 1;
+		for (std::size_t r = first; r < fast_last; ++r)
+			out[r] = static_cast<T>((load_native<uint64_t>(reports + r * stride + byte) >> shift) & mask);
+		for (std::size_t r = fast_last; r < last; ++r)
+			out[r] = static_cast<T>((load_le64(reports + r * stride, total_bytes - r * stride, byte) >> shift) & mask);
+	}
+}
+
+// Body of every kernel, inlined into each so it is compiled for that target
+[[gnu::always_inline]] inline void extract_columns(std::span<const report_columns::column> cols, std::byte* storage,
+	const uint8_t* reports, std::size_t total_bytes, std::size_t stride, std::size_t first, std::size_t rows) noexcept
+{
+	using type = report_columns::type;
+	for (const report_columns::column& c : cols) {
+		std::byte* out = storage + c.storage_offset;
+		switch (c.t) {
+			case type::u8:  extract(reports, total_bytes, stride, first, rows, c, reinterpret_cast<uint8_t*>(out)); break;
+			case type::i8:  extract(reports, total_bytes, stride, first, rows, c, reinterpret_cast<int8_t*>(out)); break;
+			case type::u16: extract(reports, total_bytes, stride, first, rows, c, reinterpret_cast<uint16_t*>(out)); break;
+			case type::i16: extract(reports, total_bytes, stride, first, rows, c, reinterpret_cast<int16_t*>(out)); break;
+			case type::u32: extract(reports, total_bytes, stride, first, rows, c, reinterpret_cast<uint32_t*>(out)); break;
+			case type::i32: extract(reports, total_bytes, stride, first, rows, c, reinterpret_cast<int32_t*>(out)); break;
+		}
+	}
+}
+
+void extract_baseline(std::span<const report_columns::column> cols, std::byte* storage,
+	const uint8_t* reports, std::size_t total_bytes, std::size_t stride, std::size_t first, std::size_t rows) noexcept
+{
+	extract_columns(cols, storage, reports, total_bytes, stride, first, rows);
+}
+
+#if HID_COLUMNS_AVX2
+[[gnu::target("avx2")]] void extract_avx2(std::span<const report_columns::column> cols, std::byte* storage,
+	const uint8_t* reports, std::size_t total_bytes, std::size_t stride, std::size_t first, std::size_t rows) noexcept
+{
+	extract_columns(cols, storage, reports, total_bytes, stride, first, rows);
+}
+#endif
+
+} // namespace
+
+bool report_columns::supports(kernel k) noexcept {
+	switch (k) {
+		case kernel::baseline: return true;
+		case kernel::avx2:
+#if HID_COLUMNS_AVX2
+			__builtin_cpu_init();
+			return __builtin_cpu_supports("avx2");
+#else
+			return false;
+#endif
+	}
+	return false;
+}
+
+report_columns::kernel report_columns::best_kernel() noexcept {
+	return supports(kernel::avx2) ? kernel::avx2 : kernel::baseline;
+}
+
+void report_columns::use_kernel(kernel k) {
+	if (!supports(k)) throw std::invalid_argument("Column kernel not supported by this CPU");
+	active = k;
+}
+
+report_columns::report_columns(const report_decoder& decoder)
+	: min_stride(decoder.report_bytes())
+{
+	cols.reserve(decoder.max_values());
+	for (const report_decoder::slot& s : decoder.slots())
+		cols.push_back({s.bit_offset, s.bit_width, column_type(s), 0});
+}
+
+void report_columns::reserve(std::size_t rows) {
+	if (rows <= capacity) return;
+	std::size_t total = 0;
+	for (column& c : cols) {
+		c.storage_offset = total;
+		total += (rows * type_size(c.t) + column_alignment - 1) & ~(column_alignment - 1);
+	}
+	storage = std::make_unique_for_overwrite<std::byte[]>(total);
+	capacity = rows;
+}
+
+void report_columns::decode(std::span<const uint8_t> reports, std::size_t stride, std::size_t max_workers) {
+	if (stride == 0 || stride < min_stride) throw std::invalid_argument("Report stride is shorter than the report");
+	if (reports.size() % stride) throw std::invalid_argument("Report batch is not a whole number of reports");
+	const std::size_t rows = reports.size() / stride;
+	reserve(rows);
+	nrows = rows;
+	const std::size_t chunks = (rows + chunk_rows - 1) / chunk_rows;
+	parallel_for(chunks, [&](std::size_t i) {
+		const std::size_t first = i * chunk_rows;
+		decode_rows(reports.data(), reports.size(), stride, first, std::min(chunk_rows, rows - first));
+	}, max_workers);
+}
+
+void report_columns::decode_rows(const uint8_t* reports, std::size_t total_bytes, std::size_t stride,
+	std::size_t first, std::size_t rows) noexcept
+{
+#if HID_COLUMNS_AVX2
+	if (active == kernel::avx2) {
+		extract_avx2(cols, storage.get(), reports, total_bytes, stride, first, rows);
+		return;
+	}
+#endif
+	extract_baseline(cols, storage.get(), reports, total_bytes, stride, first, rows);
+}
+
+int64_t report_columns::at(std::size_t c, std::size_t row) const noexcept {
+	const std::byte* p = storage.get() + cols[c].storage_offset;
+	switch (cols[c].t) {
+		case type::u8:  return reinterpret_cast<const uint8_t*>(p)[row];
+		case type::i8:  return reinterpret_cast<const int8_t*>(p)[row];
+		case type::u16: return reinterpret_cast<const uint16_t*>(p)[row];
+		case type::i16: return reinterpret_cast<const int16_t*>(p)[row];
+		case type::u32: return reinterpret_cast<const uint32_t*>(p)[row];
+		case type::i32: return reinterpret_cast<const int32_t*>(p)[row];
+	}
+	return 0;
+}
+
+} // namespace hid
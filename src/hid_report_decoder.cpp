@@ -0,0 +1,94 @@
+// Descriptor-compiled HID report decoder.
+#include "hid_report_decoder.h"
+#include "hid_stats.h"
+#include "priv/hid_report_bits.h"
+
+#include <algorithm>
+
+namespace hid {
+
+namespace {
+
+using report_field = report_descriptor_tree::report_field;
+using detail::usage_page_of;
+using detail::usage_id_of;
+using detail::load_le64;
+
+} // namespace
+
+report_decoder report_decoder::compile(const report_descriptor_tree& tree, uint8_t report_id, field_kind kind) {
+	report_decoder dec;
+	dec.report_id_ = report_id;
+	const auto layout = tree.layout(report_id, kind);
+	for (const report_field* f : layout.fields) {
+		const uint32_t width = f->report_size_bits;
+		if (f->flags.is_constant() || width == 0 || width > 32) continue;
+		const bool is_array = !f->flags.is_variable();
+		const auto usages = tree.usages(*f);
+		slot s{};
+		s.bit_width   = static_cast<uint8_t>(width);
+		s.is_signed   = f->logical_min < 0;
+		s.is_array    = is_array;
+		s.logical_min = f->logical_min;
+		if (is_array) {
+			s.usage_page  = f->usage_page;
+			s.range_first = static_cast<uint32_t>(dec.ranges_.size());
+			s.range_count = static_cast<uint32_t>(usages.ranges().size());
+			dec.ranges_.insert(dec.ranges_.end(), usages.ranges().begin(), usages.ranges().end());
+		} else {
+			s.usage_page = f->usage_page;
+		}
+		auto next_usage = usages.begin();
+		uint32_t bit = f->bit_offset;
+		for (uint32_t i = 0; i < f->report_count; ++i, bit += width) {
+			s.bit_offset = bit;
+			// Trailing values reuse the last usage (HID 1.11 §6.2.2.8)
+			if (!is_array && next_usage != usages.end()) {
+				const uint32_t u = *next_usage++;
+				s.usage_page = usage_page_of(u, f->usage_page);
+				s.usage      = usage_id_of(u);
+			}
+			dec.slots_.push_back(s);
+		}
+	}
+	dec.report_bits_ = layout.bit_length;
+	return dec;
+}
+
+std::size_t report_decoder::decode(std::span<const uint8_t> payload, std::span<value> out) const noexcept {
+	stats::scoped_timer timed(stats::op::decode);
+	const uint8_t* data = payload.data();
+	const std::size_t size = payload.size();
+	const std::size_t size_bits = size * 8;
+	std::size_t n = 0;
+	for (uint32_t i = 0; i < slots_.size() && n < out.size(); ++i) {
+		const slot& s = slots_[i];
+		if (s.bit_offset + s.bit_width > size_bits) break;
+		const uint64_t raw = load_le64(data, size, s.bit_offset >> 3) >> (s.bit_offset & 7);
+		const uint64_t mask = (uint64_t{1} << s.bit_width) - 1;
+		uint64_t bits = raw & mask;
+		int64_t v;
+		if (s.is_signed) {
+			const uint64_t sign = uint64_t{1} << (s.bit_width - 1);
+			v = static_cast<int64_t>((bits ^ sign) - sign);
+		} else {
+			v = static_cast<int64_t>(bits);
+		}
+		if (s.is_array) {
+			int64_t index = v - s.logical_min;
+			if (index < 0) continue;
+			const usage_range* r    = ranges_.data() + s.range_first;
+			const usage_range* last = r + s.range_count;
+			for (; r != last && static_cast<uint64_t>(index) >= r->size(); ++r)
+				index -= static_cast<int64_t>(r->size());
+			if (r == last) continue;
+			const uint32_t u = r->min + static_cast<uint32_t>(index);
+			out[n++] = {usage_page_of(u, s.usage_page), usage_id_of(u), v, i};
+		} else {
+			out[n++] = {s.usage_page, s.usage, v, i};
+		}
+	}
+	return n;
+}
+
+} // namespace hid
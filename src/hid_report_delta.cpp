@@ -0,0 +1,76 @@
+// Change detection for streamed input reports.
+#include "hid_report_delta.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace hid {
+
+namespace {
+
+// Compares a word at a time and accumulates the differences without
+// branching, which GCC and Clang turn into vector compares. Reports are
+// mostly a few dozen bytes, where a memcmp call costs more than the compare.
+bool same_bytes(const uint8_t* a, const uint8_t* b, std::size_t n) noexcept {
+	uint64_t diff = 0;
+	std::size_t i = 0;
+	for (; i + 8 <= n; i += 8) {
+		uint64_t x, y;
+		std::memcpy(&x, a + i, 8);
+		std::memcpy(&y, b + i, 8);
+		diff |= x ^ y;
+	}
+	for (; i < n; ++i) diff |= a[i] ^ b[i];
+	return diff == 0;
+}
+
+} // namespace
+
+report_delta::verdict report_delta::check(uint8_t report_id, std::span<const uint8_t> payload, clock::time_point now) {
+	last_report& l = last[report_id];
+	const bool keyframe_due = !l.seen
+		|| (keyframe_interval.count() > 0 && now - l.keyframe >= keyframe_interval);
+	if (!keyframe_due && l.bytes.size() == payload.size() && same_bytes(l.bytes.data(), payload.data(), payload.size())) {
+		++nrepeats;
+		return verdict::repeat;
+	}
+	// assign() reuses the buffer, so only the first report of an ID allocates
+	l.bytes.assign(payload.begin(), payload.end());
+	if (!keyframe_due) return verdict::changed;
+	l.keyframe = now;
+	l.seen = true;
+	return verdict::keyframe;
+}
+
+std::size_t report_delta::changed_values(const report_decoder& decoder, std::span<const value> values, std::span<value> out) {
+	std::vector<value>& prev = last[decoder.report_id()].values;
+	const auto slots = decoder.slots();
+	auto is_array = [&](const value& v) { return slots[v.slot].is_array; };
+	std::size_t n = 0;
+
+	// Variable fields: both lists are in slot order
+	auto p = prev.cbegin();
+	for (const value& v : values) {
+		if (is_array(v)) continue;
+		while (p != prev.cend() && (is_array(*p) || p->slot < v.slot)) ++p;
+		if (p == prev.cend() || p->slot != v.slot || p->value != v.value) out[n++] = v;
+	}
+
+	// Array fields: usages that appeared, then usages that went away
+	auto holds = [&](std::span<const value> list, const value& u) {
+		return std::ranges::any_of(list, [&](const value& x) {
+			return is_array(x) && x.usage_page == u.usage_page && x.usage == u.usage;
+		});
+	};
+	for (const value& v : values) {
+		if (is_array(v) && !holds(prev, v)) out[n++] = v;
+	}
+	for (const value& v : prev) {
+		if (is_array(v) && !holds(values, v)) out[n++] = {v.usage_page, v.usage, 0, v.slot};
+	}
+
+	prev.assign(values.begin(), values.end());
+	return n;
+}
+
+} // namespace hid
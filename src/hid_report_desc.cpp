@@ -3,9 +3,12 @@
 #include "priv/hid_report_item.h"
 
 #include <iterator>
-#include <stack>
 #include <array>
 #include <algorithm>
+#include <format>
+#include <memory>
+#include <stdexcept>
+#include <type_traits>
 
 namespace hid {
 
@@ -32,42 +35,129 @@ struct global_state {
 	int8_t   unit_exponent = 0;
 };
 
+// Usage items are written straight into the output usage pool, just past the
+// ranges of the last field, so the next field takes them over in place.
 struct local_state {
-	std::vector<uint32_t> usages;
+	uint32_t nusages = 0; // pending ranges; consecutive values coalesce into one
 	bool     has_usage_minmax = false;
 	uint32_t usage_min = 0;
 	uint32_t usage_max = 0;
-	void clear() { usages.clear(); has_usage_minmax = false; usage_min = usage_max = 0; }
+	void clear() { nusages = 0; has_usage_minmax = false; usage_min = usage_max = 0; }
+};
+
+// Fixed-capacity stack for the parser's nesting state, over arena storage
+template<typename T>
+class bounded_stack {
+public:
+	explicit bounded_stack(std::span<T> storage) noexcept : items(storage) {}
+	bool empty() const noexcept { return n == 0; }
+	std::size_t size() const noexcept { return n; }
+	T& top() noexcept { return items[n - 1]; }
+	[[nodiscard]] bool push(const T& v) noexcept {
+		if (n == items.size()) return false;
+		items[n++] = v;
+		return true;
+	}
+	void pop() noexcept { --n; }
+private:
+	std::span<T> items;
+	std::size_t n = 0;
 };
 
 using collection_node = report_descriptor_tree::collection_node;
 using report_field    = report_descriptor_tree::report_field;
 using field_kind      = report_descriptor_tree::field_kind;
+using parse_limits    = report_descriptor_tree::parse_limits;
+using reason          = descriptor_error::reason;
+
+constexpr uint32_t npos = report_descriptor_tree::npos;
+
+// A collection still waiting for its End Collection
+struct open_collection {
+	uint32_t index;
+	uint32_t last_child = npos;
+};
+
+// Output arrays, sized exactly by count_nodes() before parsing starts
+struct tree_sink {
+	std::span<collection_node> collections;
+	std::span<report_field>    fields;
+	std::span<usage_range>     usages;
+	std::span<usage_range>     sorted;
+	uint32_t ncollections = 0;
+	uint32_t nfields = 0;
+	uint32_t nusages = 0;
+};
+
+using node_stack_t   = bounded_stack<open_collection>;
+using global_stack_t = bounded_stack<global_state>;
 
 struct parse_ctx {
-	collection_node*              current;
-	std::stack<collection_node*>& node_stack;
-	global_state&                 g;
-	std::stack<global_state>&     g_stack;
-	local_state&                  l;
+	tree_sink&          out;
+	node_stack_t&       node_stack;
+	global_state&       g;
+	global_stack_t&     g_stack;
+	local_state&        l;
+	const parse_limits& limits;
+	std::size_t         offset = 0;     // of the item being handled
+	uint64_t            total_usages = 0;
+	std::array<uint64_t, 3 * 256> report_bits{}; // per field kind and report ID
+
+	usage_range* pending_usages() const noexcept { return out.usages.data() + out.nusages; }
 };
 
+template<typename... Args>
+[[noreturn, gnu::cold, gnu::noinline]] static void fail(reason why, std::size_t offset, std::format_string<Args...> fmt, Args&&... args) {
+	throw descriptor_error(why, offset,
+		std::format("{} (item at byte {})", std::format(fmt, std::forward<Args>(args)...), offset));
+}
+
 using parse_handler_fn = void(*)(parse_ctx&, const item&);
 
 // --- Main item handlers ---
 
 static void make_report_field(parse_ctx& ctx, const item& it, field_kind kind) {
-	report_field f{};
+	report_field& f = ctx.out.fields[ctx.out.nfields++];
 	f.kind            = kind;
 	f.flags.raw       = static_cast<uint8_t>(it.data);
 	f.report_id       = ctx.g.report_id;
 	f.usage_page      = ctx.g.usage_page;
+	f.collection      = ctx.node_stack.top().index;
+	f.range_first     = ctx.out.nusages;
+	usage_range* first = ctx.pending_usages();
+	usage_range* last  = first + ctx.l.nusages;
 	if (ctx.l.has_usage_minmax) {
-		for (uint32_t u = ctx.l.usage_min; u <= ctx.l.usage_max; ++u)
-			f.usages.push_back(u);
-	} else if (!ctx.l.usages.empty()) {
-		f.usages = ctx.l.usages;
+		last = first;
+		if (ctx.l.usage_min <= ctx.l.usage_max)
+			*last++ = {ctx.l.usage_min, ctx.l.usage_max};
 	}
+	f.range_count = static_cast<uint32_t>(last - first);
+	f.usage_count = 0;
+	for (const usage_range* r = first; r != last; ++r)
+		f.usage_count += r->size();
+	ctx.total_usages += f.usage_count;
+	if (ctx.total_usages > ctx.limits.usages)
+		fail(reason::usages, ctx.offset, "Report descriptor declares more than {} usages", ctx.limits.usages);
+	// Fields follow each other within their report
+	uint64_t& bits = ctx.report_bits[static_cast<std::size_t>(kind) * 256 + ctx.g.report_id];
+	f.bit_offset = static_cast<uint32_t>(bits);
+	bits += uint64_t{ctx.g.report_size_bits} * ctx.g.report_count;
+	if (bits > std::min<uint64_t>(uint64_t{ctx.limits.report_bytes} * 8, UINT32_MAX))
+		fail(reason::report_size, ctx.offset, "Report ID {} is larger than {} bytes", ctx.g.report_id, ctx.limits.report_bytes);
+
+	// Sorted, merged copy at the same offset in the sorted pool for contains()
+	usage_range* sorted = ctx.out.sorted.data() + f.range_first;
+	std::ranges::copy(first, last, sorted);
+	std::ranges::sort(sorted, sorted + f.range_count, {}, &usage_range::min);
+	uint32_t merged = 0;
+	for (uint32_t i = 0; i < f.range_count; ++i) {
+		if (merged > 0 && (sorted[merged - 1].max == UINT32_MAX || sorted[i].min <= sorted[merged - 1].max + 1))
+			sorted[merged - 1].max = std::max(sorted[merged - 1].max, sorted[i].max);
+		else
+			sorted[merged++] = sorted[i];
+	}
+	f.sorted_count    = merged;
+	ctx.out.nusages  += f.range_count;
 	f.report_size_bits = ctx.g.report_size_bits;
 	f.report_count     = ctx.g.report_count;
 	f.logical_min      = ctx.g.logical_min;
@@ -76,7 +166,6 @@ static void make_report_field(parse_ctx& ctx, const item& it, field_kind kind) {
 	f.physical_max     = ctx.g.physical_max;
 	f.unit             = ctx.g.unit;
 	f.unit_exponent    = ctx.g.unit_exponent;
-	ctx.current->fields.emplace_back(std::move(f));
 	ctx.l.clear();
 }
 
@@ -85,18 +174,27 @@ static void handle_output    (parse_ctx& c, const item& it) { make_report_field(
 static void handle_feature   (parse_ctx& c, const item& it) { make_report_field(c, it, field_kind::feature); }
 
 static void handle_collection(parse_ctx& c, const item& it) {
-	auto node = std::make_unique<collection_node>();
-	node->type       = static_cast<uint8_t>(it.data);
-	node->usage_page = c.g.usage_page;
-	if (!c.l.usages.empty()) node->usage = c.l.usages.back();
-	c.current->children.emplace_back(std::move(node));
-	c.current = c.current->children.back().get();
-	c.node_stack.push(c.current);
+	const uint32_t index = c.out.ncollections++;
+	collection_node& node = c.out.collections[index];
+	node.type       = static_cast<uint8_t>(it.data);
+	node.usage_page = c.g.usage_page;
+	if (c.l.nusages != 0) node.usage = c.pending_usages()[c.l.nusages - 1].max;
+
+	open_collection& parent = c.node_stack.top();
+	node.parent = parent.index;
+	if (parent.last_child == npos)
+		c.out.collections[parent.index].first_child = index;
+	else
+		c.out.collections[parent.last_child].next_sibling = index;
+	parent.last_child = index;
+
+	if (!c.node_stack.push({index}))
+		fail(reason::collection_depth, c.offset, "Report descriptor nests collections deeper than {}", c.limits.collection_depth);
 	c.l.clear();
 }
 
 static void handle_end_collection(parse_ctx& c, const item&) {
-	if (c.node_stack.size() > 1) { c.node_stack.pop(); c.current = c.node_stack.top(); }
+	if (c.node_stack.size() > 1) c.node_stack.pop();
 	c.l.clear();
 }
 
@@ -114,12 +212,20 @@ static void g_unit         (parse_ctx& c, const item& it) { c.g.unit
 static void g_report_size  (parse_ctx& c, const item& it) { c.g.report_size_bits = it.data; }
 static void g_report_id    (parse_ctx& c, const item& it) { c.g.report_id       = static_cast<uint8_t>(it.data); }
 static void g_report_count (parse_ctx& c, const item& it) { c.g.report_count    = it.data; }
-static void g_push         (parse_ctx& c, const item&)    { c.g_stack.push(c.g); }
+static void g_push         (parse_ctx& c, const item&)    {
+	if (!c.g_stack.push(c.g))
+		fail(reason::push_depth, c.offset, "Report descriptor has more than {} nested Push items", c.limits.push_depth);
+}
 static void g_pop          (parse_ctx& c, const item&)    { if (!c.g_stack.empty()) { c.g = c.g_stack.top(); c.g_stack.pop(); } }
 
 // --- Local item handlers ---
 
-static void l_usage     (parse_ctx& c, const item& it) { c.l.usages.push_back(it.data); }
+static void l_usage     (parse_ctx& c, const item& it) {
+	usage_range* u = c.pending_usages();
+	uint32_t& n = c.l.nusages;
+	if (n != 0 && u[n - 1].max != UINT32_MAX && u[n - 1].max + 1 == it.data) u[n - 1].max = it.data;
+	else u[n++] = {it.data, it.data};
+}
 static void l_usage_min (parse_ctx& c, const item& it) { c.l.has_usage_minmax = true; c.l.usage_min = it.data; }
 static void l_usage_max (parse_ctx& c, const item& it) { c.l.has_usage_minmax = true; c.l.usage_max = it.data; }
 
@@ -150,27 +256,72 @@ static constexpr auto parse_table = std::to_array<parse_entry>({
 	{2, 0x01, l_usage_min},
 	{2, 0x02, l_usage_max},
 });
-static constexpr auto parse_entry_proj(const parse_entry& e) noexcept {
-	return std::make_tuple(e.type, e.tag);
+static constexpr auto parse_dispatch = detail::make_prefix_table<parse_handler_fn>(
+	parse_table, [](const parse_entry& e) { return e.handler; });
+
+// Node counts of a descriptor, from a cheap pre-pass over its items
+struct node_counts {
+	std::size_t collections = 1; // implicit root
+	std::size_t fields = 0;
+	std::size_t usage_ranges = 0; // peak of committed plus pending ranges
+	std::size_t pushes = 0;
+};
+
+// Also rejects truncated items and too many fields, before anything is allocated
+static node_counts count_nodes(std::span<const uint8_t> bytes, const parse_limits& limits) {
+	node_counts n;
+	std::size_t committed = 0;
+	std::size_t local_usages = 0;
+	bool has_minmax = false;
+	const uint8_t* p   = bytes.data();
+	const uint8_t* end = p + bytes.size();
+	while (p < end) {
+		const uint8_t* start = p;
+		item it = parse_item(p, end);
+		if (it.truncated)
+			fail(reason::truncated_item, static_cast<std::size_t>(start - bytes.data()), "Report descriptor ends inside an item");
+		if (it.type == 1 && it.tag == 0x0A) {
+			++n.pushes;
+		} else if (it.type == 2) {
+			// Pending Usage items occupy the pool until the next main item
+			if (it.tag == 0x00) n.usage_ranges = std::max(n.usage_ranges, committed + ++local_usages);
+			else if (it.tag == 0x01 || it.tag == 0x02) has_minmax = true;
+		} else if (it.type == 0) {
+			if (it.tag == 0x08 || it.tag == 0x09 || it.tag == 0x0B) {
+				if (++n.fields > limits.fields)
+					fail(reason::fields, static_cast<std::size_t>(start - bytes.data()),
+						"Report descriptor has more than {} fields", limits.fields);
+				// Upper bound of the ranges make_report_field() keeps
+				committed += has_minmax ? 1 : local_usages;
+				n.usage_ranges = std::max(n.usage_ranges, committed);
+			} else if (it.tag == 0x0A) {
+				++n.collections;
+			}
+			local_usages = 0;
+			has_minmax = false;
+		}
+	}
+	return n;
+}
+
+static constexpr std::size_t align_up(std::size_t n, std::size_t a) noexcept {
+	return (n + a - 1) / a * a;
 }
-static_assert(std::ranges::is_sorted(parse_table, {}, &parse_entry_proj));
 
-static parse_handler_fn find_parse_handler(uint8_t type, uint8_t tag) noexcept {
-	auto key = std::make_tuple(type, tag);
-	auto it = std::ranges::lower_bound(parse_table, key, {}, &parse_entry_proj);
-	if (it != std::ranges::end(parse_table) && parse_entry_proj(*it) == key) return it->handler;
-	return nullptr;
+// Carves n default-initialised objects of T out of the arena at offset (bumped past them)
+template<typename T>
+static std::span<T> carve(std::byte* arena, std::size_t& offset, std::size_t n) {
+	static_assert(std::is_trivially_destructible_v<T>);
+	offset = align_up(offset, alignof(T));
+	T* first = reinterpret_cast<T*>(arena + offset);
+	std::uninitialized_value_construct_n(first, n);
+	offset += n * sizeof(T);
+	return {first, n};
 }
 
-// Build report-id index by walking the finished tree (avoids pointer invalidation)
-static void build_report_index(
-	const collection_node& node,
-	std::unordered_map<uint8_t, std::vector<const report_field*>>& idx)
-{
-	for (const auto& f : node.fields)
-		idx[f.report_id].push_back(&f);
-	for (const auto& ch : node.children)
-		build_report_index(*ch, idx);
+template<typename T>
+static void reserve(std::size_t& offset, std::size_t n) noexcept {
+	offset = align_up(offset, alignof(T)) + n * sizeof(T);
 }
 
 } // namespace
@@ -180,22 +331,52 @@ static void build_report_index(
 // ════════════════════════════════════════════════════════════════════════════
 
 report_descriptor_tree report_descriptor_tree::parse(std::span<const uint8_t> bytes) {
+	return parse(bytes, parse_limits{});
+}
+
+report_descriptor_tree report_descriptor_tree::parse(std::span<const uint8_t> bytes, const parse_limits& limits) {
+	const node_counts counts = count_nodes(bytes, limits);
+	// The stacks never need to hold more than the descriptor has items for;
+	// the root occupies one slot of the node stack
+	const std::size_t node_depth = std::min(limits.collection_depth, counts.collections - 1) + 1;
+	const std::size_t push_depth = std::min(limits.push_depth, counts.pushes);
+
+	std::size_t size = 0;
+	reserve<collection_node>(size, counts.collections);
+	reserve<report_field>(size, counts.fields);
+	reserve<usage_range>(size, counts.usage_ranges);
+	reserve<usage_range>(size, counts.usage_ranges);
+	reserve<const report_field*>(size, counts.fields);
+	// Parser scratch, left unused in the arena afterwards
+	reserve<open_collection>(size, node_depth);
+	reserve<global_state>(size, push_depth);
+
 	report_descriptor_tree tree;
-	tree.root_ = std::make_unique<collection_node>();
-	std::stack<collection_node*> nstack;
-	nstack.push(tree.root_.get());
+	tree.arena_ = std::make_unique_for_overwrite<std::byte[]>(size);
+	std::size_t offset = 0;
+	tree_sink out{
+		.collections = carve<collection_node>(tree.arena_.get(), offset, counts.collections),
+		.fields      = carve<report_field>(tree.arena_.get(), offset, counts.fields),
+		.usages      = carve<usage_range>(tree.arena_.get(), offset, counts.usage_ranges),
+		.sorted      = carve<usage_range>(tree.arena_.get(), offset, counts.usage_ranges),
+	};
+	tree.index_ = carve<const report_field*>(tree.arena_.get(), offset, counts.fields);
+
+	node_stack_t nstack(carve<open_collection>(tree.arena_.get(), offset, node_depth));
+	(void)nstack.push({out.ncollections++});
 
 	global_state g{};
-	std::stack<global_state> gstack;
+	global_stack_t gstack(carve<global_state>(tree.arena_.get(), offset, push_depth));
 	local_state l{};
 
-	parse_ctx ctx{tree.root_.get(), nstack, g, gstack, l};
+	parse_ctx ctx{out, nstack, g, gstack, l, limits};
 
 	const uint8_t* p   = bytes.data();
 	const uint8_t* end = p + bytes.size();
 	while (p < end) {
+		ctx.offset = static_cast<std::size_t>(p - bytes.data());
 		item it = parse_item(p, end);
-		auto handler = find_parse_handler(it.type, it.tag);
+		auto handler = parse_dispatch[it.prefix];
 		if (handler) {
 			handler(ctx, it);
 		} else if (it.type == 0) {
@@ -203,16 +384,34 @@ report_descriptor_tree report_descriptor_tree::parse(std::span<const uint8_t> by
 		}
 	}
 
-	build_report_index(*tree.root_, tree.index_by_report_id_);
-	return tree;
-}
+	tree.collections_ = out.collections;
+	tree.fields_      = out.fields;
+	tree.usage_pool_  = out.usages.first(out.nusages);
+	tree.sorted_pool_ = out.sorted.first(out.nusages);
+
+	// Report index: counting sort of fields by (ID, kind), stable so each report
+	// keeps descriptor order and its fields' bit offsets ascend
+	auto key = [](const report_field& f) { return std::size_t{f.report_id} * 3 + static_cast<std::size_t>(f.kind); };
+	auto& offsets = tree.index_offsets_;
+	for (const report_field& f : tree.fields_)
+		++offsets[key(f) + 1];
+	for (std::size_t k = 1; k < offsets.size(); ++k)
+		offsets[k] += offsets[k - 1];
+	std::array<uint32_t, 3 * 256> cursor;
+	std::ranges::copy(std::span(offsets).first<3 * 256>(), cursor.begin());
+	for (const report_field& f : tree.fields_)
+		tree.index_[cursor[key(f)]++] = &f;
+
+	// ctx.report_bits ends as every report's total length
+	for (std::size_t kind = 0; kind < 3; ++kind) {
+		for (std::size_t id = 0; id < 256; ++id) {
+			const auto bytes = static_cast<uint32_t>((ctx.report_bits[kind * 256 + id] + 7) / 8);
+			tree.max_report_bytes_[kind] = std::max(tree.max_report_bytes_[kind], bytes);
+		}
+	}
+	tree.uses_report_ids_ = offsets[3] != offsets.back();
 
-std::vector<const report_descriptor_tree::report_field*>
-report_descriptor_tree::find_by_report_id(uint8_t report_id) const {
-	auto it = index_by_report_id_.find(report_id);
-	if (it == index_by_report_id_.end()) return {};
-	return it->second;
+	return tree;
 }
 
 } // namespace hid
-
@@ -1,12 +1,19 @@
 // Human-readable HID report descriptor dump
+#include <unistd.h>
+
 #include "hid_report_desc_dump.h"
 #include "priv/hid_report_item.h"
+#include "priv/hidraw_priv.h"
+#include "hex_codec.h"
 
 #include <type_traits>
 #include <iterator>
 #include <array>
 #include <format>
 #include <algorithm>
+#include <charconv>
+#include <ostream>
+#include <stdexcept>
 #include <string_view>
 
 namespace hid {
@@ -31,11 +38,23 @@ static constexpr auto collection_types = std::to_array<named_u8>({
 	{0x03, "Report"},        {0x04, "Named Array"},
 	{0x05, "Usage Switch"},  {0x06, "Usage Modifier"},
 });
-static_assert(std::ranges::is_sorted(collection_types, {}, &named_u8::value));
+
+// Usage pages and collection types are small dense ranges, so their names
+// are indexed directly rather than searched.
+template<std::size_t Size, typename Entry, std::size_t N>
+consteval std::array<std::string_view, Size> make_name_index(const std::array<Entry, N>& entries) {
+	std::array<std::string_view, Size> t{};
+	for (const Entry& e : entries) {
+		if (e.value >= Size || !t[e.value].empty()) throw "name index entry out of range or duplicated";
+		t[e.value] = e.name;
+	}
+	return t;
+}
+
+static constexpr auto collection_type_index = make_name_index<8>(collection_types);
 
 static std::string_view collection_type_name(uint8_t t) noexcept {
-	auto it = std::ranges::lower_bound(collection_types, t, {}, &named_u8::value);
-	if (it != std::ranges::end(collection_types) && it->value == t) return it->name;
+	if (t < collection_type_index.size() && !collection_type_index[t].empty()) return collection_type_index[t];
 	return (t >= 0x80) ? "Vendor Defined" : "Reserved";
 }
 
@@ -51,15 +70,9 @@ static constexpr auto usage_pages = std::to_array<named_u16>({
 	{0x0F, "PID"},                  {0x10, "Unicode"},
 	{0x14, "Alphanumeric Display"},
 });
-static_assert(std::ranges::is_sorted(usage_pages, {}, &named_u16::value));
-
-static std::string usage_page_name(uint16_t page) {
-	auto it = std::ranges::lower_bound(usage_pages, page, {}, &named_u16::value);
-	if (it != std::ranges::end(usage_pages) && it->value == page) return std::string(it->name);
-	if (page >= 0xFF00)
-		return std::format("Vendor Defined 0x{:04X}", page);
-	return std::format("0x{:04X}", page);
-}
+
+static constexpr auto usage_page_index = make_name_index<0x20>(usage_pages);
+
 
 // Known usages organised by page
 static constexpr auto known_usages = std::to_array<usage_entry>({
@@ -95,20 +108,110 @@ static constexpr auto known_usages = std::to_array<usage_entry>({
 	{0x0E, 0x23, "Intensity"},           {0x0E, 0x24, "Repeat Count"},
 	{0x0E, 0x25, "Retrigger Period"},    {0x0E, 0x28, "Waveform Cutoff Time"},
 });
-static constexpr auto usage_entry_proj(const usage_entry& e) noexcept {
-	return std::make_tuple(e.page, e.usage);
+
+static constexpr uint64_t usage_key(uint16_t page, uint32_t usage) noexcept {
+	return (uint64_t{page} << 32) | usage;
+}
+
+// Perfect hash over known_usages: slot = top bits of key * seed, with the seed
+// searched at compile time until no two known usages share a slot. Each slot
+// holds an index into known_usages plus one, so a lookup is one multiply and
+// one key compare.
+constexpr unsigned usage_hash_bits = 8;
+
+static constexpr std::size_t usage_slot(uint64_t key, uint64_t seed) noexcept {
+	return static_cast<std::size_t>((key * seed) >> (64 - usage_hash_bits));
+}
+
+struct usage_hash_table {
+	uint64_t seed = 0;
+	std::array<uint8_t, std::size_t{1} << usage_hash_bits> slots{};
+};
+
+static constexpr usage_hash_table usage_hash = [] consteval {
+	static_assert(known_usages.size() < 0xFF);
+	usage_hash_table h;
+	// Candidates step by the golden ratio; nearby seeds would share their top product bits
+	uint64_t candidate = 0;
+	for (int attempt = 0; attempt < 1024; ++attempt) {
+		candidate += 0x9E3779B97F4A7C15;
+		const uint64_t seed = candidate | 1;
+		h.seed = seed;
+		h.slots.fill(0);
+		bool ok = true;
+		for (std::size_t i = 0; ok && i < known_usages.size(); ++i) {
+			uint8_t& slot = h.slots[usage_slot(usage_key(known_usages[i].page, known_usages[i].usage), seed)];
+			ok = slot == 0;
+			slot = static_cast<uint8_t>(i + 1);
+		}
+		if (ok) return h;
+	}
+	throw "no perfect hash seed found for known_usages";
+}();
+
+} // namespace
+
+std::string_view find_usage_page_name(uint16_t page) noexcept {
+	return page < usage_page_index.size() ? usage_page_index[page] : std::string_view{};
+}
+
+std::string_view find_usage_name(uint16_t page, uint32_t usage) noexcept {
+	const uint64_t key = usage_key(page, usage);
+	const uint8_t slot = usage_hash.slots[usage_slot(key, usage_hash.seed)];
+	if (slot == 0) return {};
+	const usage_entry& e = known_usages[slot - 1];
+	return usage_key(e.page, e.usage) == key ? e.name : std::string_view{};
+}
+
+std::optional<std::pair<uint16_t, uint32_t>> find_usage_by_name(std::string_view name) noexcept {
+	auto iequals = [](std::string_view a, std::string_view b) {
+		auto lower = [](char c) { return c >= 'A' && c <= 'Z' ? static_cast<char>(c - 'A' + 'a') : c; };
+		return std::ranges::equal(a, b, {}, lower, lower);
+	};
+	for (const usage_entry& e : known_usages)
+		if (iequals(e.name, name)) return std::pair{e.page, e.usage};
+	constexpr std::string_view button = "Button ";
+	if (name.size() > button.size() && iequals(name.substr(0, button.size()), button)) {
+		const std::string_view n = name.substr(button.size());
+		uint32_t usage = 0;
+		auto [ptr, ec] = std::from_chars(n.data(), n.data() + n.size(), usage);
+		if (ec == std::errc{} && ptr == n.data() + n.size() && usage > 0) return std::pair{uint16_t{0x09}, usage};
+	}
+	return std::nullopt;
+}
+
+void append_usage_page_name(std::string& out, uint16_t page) {
+	if (std::string_view name = find_usage_page_name(page); !name.empty())
+		out += name;
+	else if (page >= 0xFF00)
+		std::format_to(std::back_inserter(out), "Vendor Defined 0x{:04X}", page);
+	else
+		std::format_to(std::back_inserter(out), "0x{:04X}", page);
+}
+
+void append_usage_name(std::string& out, uint16_t page, uint32_t usage) {
+	if (std::string_view name = find_usage_name(page, usage); !name.empty())
+		out += name;
+	else if (page == 0x09 && usage > 0)
+		std::format_to(std::back_inserter(out), "Button {}", usage);
+	else
+		std::format_to(std::back_inserter(out), "0x{:X}", usage);
 }
-static_assert(std::ranges::is_sorted(known_usages, {}, &usage_entry_proj));
-
-static std::string usage_name(uint16_t page, uint32_t usage) {
-	auto key = std::make_tuple(page, usage);
-	auto it = std::ranges::lower_bound(known_usages, key, {}, &usage_entry_proj);
-	if (it != std::ranges::end(known_usages) && usage_entry_proj(*it) == key) return std::string(it->name);
-	if (page == 0x09 && usage > 0)
-		return std::format("Button {}", usage);
-	return std::format("0x{:X}", usage);
+
+std::string usage_page_name(uint16_t page) {
+	std::string s;
+	append_usage_page_name(s, page);
+	return s;
 }
 
+std::string usage_name(uint16_t page, uint32_t usage) {
+	std::string s;
+	append_usage_name(s, page, usage);
+	return s;
+}
+
+namespace {
+
 // ════════════════════════════════════════════════════════════════════════════
 // Input/Output/Feature flag bits — HID 1.11 §6.2.2.5
 // ════════════════════════════════════════════════════════════════════════════
@@ -127,20 +230,16 @@ static constexpr auto iof_flags = std::to_array<flag_pair>({
 	{"No Null Position","Null Position"},
 });
 
-static std::string iof_flags_text(uint8_t raw, iof_kind kind) {
-	std::string s;
-	auto append = [&](std::string_view v) {
-		if (!s.empty()) s += ',';
-		s += v;
-	};
-	for (int i = 0; i < 7; ++i)
-		append((raw & (1 << i)) ? iof_flags[i].set : iof_flags[i].clear);
+static void append_iof_flags(std::string& out, uint8_t raw, iof_kind kind) {
+	for (int i = 0; i < 7; ++i) {
+		out += (raw & (1 << i)) ? iof_flags[i].set : iof_flags[i].clear;
+		out += ',';
+	}
 	// Bit 7: Input → Bitfield/Buffered Bytes; Output/Feature → Non Volatile/Volatile
 	if (kind == iof_kind::input)
-		append((raw & 0x80) ? "Buffered Bytes" : "Bitfield");
+		out += (raw & 0x80) ? "Buffered Bytes" : "Bitfield";
 	else
-		append((raw & 0x80) ? "Volatile" : "Non-volatile");
-	return s;
+		out += (raw & 0x80) ? "Volatile" : "Non-volatile";
 }
 
 // ════════════════════════════════════════════════════════════════════════════
@@ -200,33 +299,8 @@ static constexpr auto item_table = std::to_array<item_meta>({
 	{2, 0x09, "String Maximum",     value_kind::u32},
 	{2, 0x0A, "Delimiter",          value_kind::u32},
 });
-static constexpr auto item_meta_proj(const item_meta& e) noexcept {
-	return std::make_tuple(e.type, e.tag);
-}
-static_assert(std::ranges::is_sorted(item_table, {}, &item_meta_proj));
-
-static const item_meta* find_meta(uint8_t type, uint8_t tag) noexcept {
-	auto key = std::make_tuple(type, tag);
-	auto it = std::ranges::lower_bound(item_table, key, {}, &item_meta_proj);
-	if (it != std::ranges::end(item_table) && item_meta_proj(*it) == key) return &*it;
-	return nullptr;
-}
-
-static std::string format_value(const item_meta& meta, const item& it, uint16_t ctx_usage_page) {
-	switch (meta.vk) {
-		case value_kind::none:           return {};
-		case value_kind::u32:            return std::format("{}", it.data);
-		case value_kind::i32:            return std::format("{}", sign_extend(it.data, it.size));
-		case value_kind::hex:            return std::format("0x{:02X}", it.data);
-		case value_kind::usage_page_fmt: return usage_page_name(static_cast<uint16_t>(it.data));
-		case value_kind::usage_fmt:      return usage_name(ctx_usage_page, it.data);
-		case value_kind::collection_fmt: return std::string(collection_type_name(static_cast<uint8_t>(it.data)));
-		case value_kind::iof_input:      return iof_flags_text(static_cast<uint8_t>(it.data), iof_kind::input);
-		case value_kind::iof_output:     return iof_flags_text(static_cast<uint8_t>(it.data), iof_kind::output);
-		case value_kind::iof_feature:    return iof_flags_text(static_cast<uint8_t>(it.data), iof_kind::feature);
-	}
-	return {};
-}
+static constexpr auto item_dispatch = detail::make_prefix_table<const item_meta*>(
+	item_table, [](const item_meta& e) { return &e; });
 
 // ════════════════════════════════════════════════════════════════════════════
 // Formatting helpers
@@ -237,11 +311,24 @@ static void append_format(std::string& out, std::type_identity_t<std::format_str
 	std::format_to(std::back_inserter(out), fmt, std::forward<Args>(args)...);
 }
 
-static void append_item_bytes(std::string& out, const uint8_t* start, const uint8_t* end) {
-	for (const uint8_t* p = start; p < end; ++p) {
-		if (p != start) out += ", ";
-		append_format(out, "0x{:02X}", *p);
+// Appends the parenthesised value of an item; vk must not be value_kind::none
+static void append_value(std::string& out, const item_meta& meta, const item& it, uint16_t ctx_usage_page) {
+	switch (meta.vk) {
+		case value_kind::none:           break;
+		case value_kind::u32:            append_format(out, "{}", it.data); break;
+		case value_kind::i32:            append_format(out, "{}", sign_extend(it.data, it.size)); break;
+		case value_kind::hex:            append_format(out, "0x{:02X}", it.data); break;
+		case value_kind::usage_page_fmt: append_usage_page_name(out, static_cast<uint16_t>(it.data)); break;
+		case value_kind::usage_fmt:      append_usage_name(out, ctx_usage_page, it.data); break;
+		case value_kind::collection_fmt: out += collection_type_name(static_cast<uint8_t>(it.data)); break;
+		case value_kind::iof_input:      append_iof_flags(out, static_cast<uint8_t>(it.data), iof_kind::input); break;
+		case value_kind::iof_output:     append_iof_flags(out, static_cast<uint8_t>(it.data), iof_kind::output); break;
+		case value_kind::iof_feature:    append_iof_flags(out, static_cast<uint8_t>(it.data), iof_kind::feature); break;
 	}
+}
+
+static void append_item_bytes(std::string& out, const uint8_t* start, const uint8_t* end) {
+	hex::append(out, std::span(start, end), hex::c_array_layout);
 	std::size_t len = static_cast<std::size_t>(end - start);
 	std::size_t pad = (len * 6 >= 24) ? 1 : (24 - len * 6);
 	out.append(pad, ' ');
@@ -249,14 +336,21 @@ static void append_item_bytes(std::string& out, const uint8_t* start, const uint
 
 static constexpr auto type_fallback_names = std::to_array<std::string_view>({"Main", "Global", "Local", "Reserved"});
 
-} // namespace
+// Output is formatted line by line into buf, which is handed to the sink and
+// cleared whenever it reaches this size. Without a sink buf keeps everything.
+constexpr std::size_t sink_chunk_size = 4096;
 
-// ════════════════════════════════════════════════════════════════════════════
-// Public API
-// ════════════════════════════════════════════════════════════════════════════
+// Indentation stops growing past this many collection levels, which keeps the
+// dump linear in the descriptor size however deeply it nests
+constexpr int max_indent_depth = 32;
 
-std::string descriptor_to_string(std::span<const uint8_t> bytes) {
-	std::string result;
+static void dump_descriptor(std::span<const uint8_t> bytes, std::string& result, const dump_sink* sink) {
+	auto flush = [&] {
+		if (sink && !result.empty()) {
+			(*sink)(result);
+			result.clear();
+		}
+	};
 	const uint8_t* p   = bytes.data();
 	const uint8_t* end = p + bytes.size();
 	uint16_t usage_page = 0;
@@ -274,27 +368,81 @@ std::string descriptor_to_string(std::span<const uint8_t> bytes) {
 
 		// Indent
 		result.append("// ");
-		result.append(depth * 2, ' ');
+		result.append(std::min(depth, max_indent_depth) * 2, ' ');
 
-		if (const item_meta* meta = find_meta(it.type, it.tag)) {
+		if (const item_meta* meta = item_dispatch[it.prefix]) {
 			if (it.type == 1 && it.tag == 0x00)
 				usage_page = static_cast<uint16_t>(it.data);
 
-			std::string value = format_value(*meta, it, usage_page);
-			if (value.empty())
-				append_format(result, "{}\n", meta->name);
-			else
-				append_format(result, "{} ({})\n", meta->name, value);
+			result += meta->name;
+			if (meta->vk != value_kind::none) {
+				result += " (";
+				append_value(result, *meta, it, usage_page);
+				result += ')';
+			}
+			result += '\n';
 		} else {
 			append_format(result, "{} (tag=0x{:X})\n", type_fallback_names[it.type & 3], it.tag);
 		}
+		if (it.truncated) {
+			result.pop_back();
+			result += " [truncated]\n";
+		}
 
 		// Collection increases depth after the annotation line
 		if (it.type == 0 && it.tag == 0x0A) ++depth;
+
+		if (result.size() >= sink_chunk_size) flush();
 	}
 
 	append_format(result, "\n// {} bytes\n", bytes.size());
+	flush();
+}
+
+} // namespace
+
+// ════════════════════════════════════════════════════════════════════════════
+// Public API
+// ════════════════════════════════════════════════════════════════════════════
+
+std::string descriptor_to_string(std::span<const uint8_t> bytes) {
+	std::string result;
+	dump_descriptor(bytes, result, nullptr);
 	return result;
 }
 
+void write_descriptor(std::span<const uint8_t> bytes, const dump_sink& sink) {
+	std::string buf;
+	buf.reserve(sink_chunk_size + 256);
+	dump_descriptor(bytes, buf, &sink);
+}
+
+void write_descriptor(std::span<const uint8_t> bytes, std::FILE* out) {
+	write_descriptor(bytes, [out](std::string_view chunk) {
+		if (std::fwrite(chunk.data(), 1, chunk.size(), out) != chunk.size())
+			hidraw::throw_system_error("Failed to write descriptor dump");
+	});
+}
+
+void write_descriptor(std::span<const uint8_t> bytes, int fd) {
+	write_descriptor(bytes, [fd](std::string_view chunk) {
+		while (!chunk.empty()) {
+			::ssize_t n = ::write(fd, chunk.data(), chunk.size());
+			if (n < 0) {
+				if (errno == EINTR) continue;
+				hidraw::throw_system_error("Failed to write descriptor dump");
+			}
+			chunk.remove_prefix(static_cast<std::size_t>(n));
+		}
+	});
+}
+
+void write_descriptor(std::span<const uint8_t> bytes, std::ostream& out) {
+	write_descriptor(bytes, [&out](std::string_view chunk) {
+		if (!out.write(chunk.data(), static_cast<std::streamsize>(chunk.size())))
+			throw std::runtime_error("Failed to write descriptor dump");
+	});
+	if (!out.flush()) throw std::runtime_error("Failed to write descriptor dump");
+}
+
 } // namespace hid
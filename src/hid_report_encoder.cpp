@@ -0,0 +1,137 @@
+// Descriptor-compiled HID report encoder.
+#include "hid_report_encoder.h"
+#include "priv/hid_report_bits.h"
+
+#include <algorithm>
+#include <format>
+#include <stdexcept>
+
+namespace hid {
+
+namespace {
+
+using report_field = report_descriptor_tree::report_field;
+using detail::usage_page_of;
+using detail::usage_id_of;
+using detail::store_bits;
+
+// Index of (page, usage) within an array slot's usage list, or -1
+static int64_t array_index(const report_encoder::slot& s, const usage_range* ranges, uint16_t page, uint32_t usage) noexcept {
+	int64_t index = 0;
+	for (const usage_range* r = ranges + s.range_first; r != ranges + s.range_first + s.range_count; ++r) {
+		// An extended range carries its page in the upper 16 bits of both ends
+		if (usage_page_of(r->min, s.usage_page) == page && usage_id_of(r->min) <= usage && usage <= usage_id_of(r->max))
+			return index + (usage - usage_id_of(r->min));
+		index += static_cast<int64_t>(r->size());
+	}
+	return -1;
+}
+
+} // namespace
+
+report_encoder report_encoder::compile(const report_descriptor_tree& tree, uint8_t report_id, field_kind kind) {
+	report_encoder enc;
+	enc.report_id_ = report_id;
+	uint32_t field = 0;
+	const auto layout = tree.layout(report_id, kind);
+	for (const report_field* f : layout.fields) {
+		const uint32_t width = f->report_size_bits;
+		if (f->flags.is_constant() || width == 0 || width > 32) continue;
+		const bool is_array = !f->flags.is_variable();
+		const auto usages = tree.usages(*f);
+		slot s{};
+		s.bit_width   = static_cast<uint8_t>(width);
+		s.is_array    = is_array;
+		s.usage_page  = f->usage_page;
+		s.field       = field++;
+		s.logical_min = f->logical_min;
+		s.logical_max = f->logical_max;
+		if (is_array) {
+			s.range_first = static_cast<uint32_t>(enc.ranges_.size());
+			s.range_count = static_cast<uint32_t>(usages.ranges().size());
+			enc.ranges_.insert(enc.ranges_.end(), usages.ranges().begin(), usages.ranges().end());
+		}
+		auto next_usage = usages.begin();
+		uint32_t bit = f->bit_offset;
+		for (uint32_t i = 0; i < f->report_count; ++i, bit += width) {
+			s.bit_offset = bit;
+			// Trailing values reuse the last usage (HID 1.11 §6.2.2.8)
+			if (!is_array && next_usage != usages.end()) {
+				const uint32_t u = *next_usage++;
+				s.usage_page = usage_page_of(u, f->usage_page);
+				s.usage      = usage_id_of(u);
+			}
+			enc.slots_.push_back(s);
+		}
+	}
+	enc.report_bits_ = layout.bit_length;
+	return enc;
+}
+
+std::vector<report_encoder::assignment> report_encoder::resolve(std::span<const setting> settings) const {
+	std::vector<assignment> out;
+	out.reserve(settings.size());
+	std::vector<bool> taken(slots_.size());
+	for (const setting& st : settings) {
+		bool found = false;
+		std::optional<assignment> bound;
+		for (uint32_t i = 0; i < slots_.size() && !bound; ++i) {
+			const slot& s = slots_[i];
+			int64_t index = 0;
+			if (s.is_array) {
+				index = array_index(s, ranges_.data(), st.usage_page, st.usage);
+				if (index < 0) continue;
+			} else if (s.usage_page != st.usage_page || s.usage != st.usage) {
+				continue;
+			}
+			found = true;
+			if (taken[i]) continue;
+			if (!s.is_array) {
+				int64_t v = st.value;
+				if (s.logical_min <= s.logical_max) v = std::clamp<int64_t>(v, s.logical_min, s.logical_max);
+				bound = assignment{i, v};
+			} else if (st.value != 0) {
+				const int64_t v = s.logical_min + index;
+				if (s.logical_min <= s.logical_max && v > s.logical_max)
+					throw std::runtime_error(std::format(
+						"Usage {:04X}:{:04X} lies outside the logical range of its array in report ID {}",
+						st.usage_page, st.usage, report_id_));
+				bound = assignment{i, v};
+			} else {
+				break; // a zero array value only checks that the usage exists
+			}
+		}
+		if (!found)
+			throw std::runtime_error(std::format("Report ID {} has no usage {:04X}:{:04X}", report_id_, st.usage_page, st.usage));
+		if (!bound && st.value != 0)
+			throw std::runtime_error(std::format(
+				"Usage {:04X}:{:04X} is set more often than report ID {} has slots for it", st.usage_page, st.usage, report_id_));
+		if (bound) {
+			taken[bound->slot] = true;
+			out.push_back(*bound);
+		}
+	}
+	return out;
+}
+
+void report_encoder::encode(std::span<uint8_t> payload, std::span<const assignment> values) const noexcept {
+	for (const assignment& a : values) {
+		const slot& s = slots_[a.slot];
+		store_bits(payload.data(), payload.size(), s.bit_offset, s.bit_width, static_cast<uint64_t>(a.value));
+	}
+}
+
+std::optional<uint16_t> report_encoder::find_usage_page(uint32_t usage) const noexcept {
+	for (const slot& s : slots_) {
+		if (!s.is_array) {
+			if (s.usage == usage) return s.usage_page;
+			continue;
+		}
+		for (const usage_range* r = ranges_.data() + s.range_first; r != ranges_.data() + s.range_first + s.range_count; ++r) {
+			if (usage_id_of(r->min) <= usage && usage <= usage_id_of(r->max)) return usage_page_of(r->min, s.usage_page);
+		}
+	}
+	return std::nullopt;
+}
+
+} // namespace hid
@@ -0,0 +1,89 @@
+#include "hid_report_pipe.h"
+#include "hid_stats.h"
+#include "priv/hid_thread.h"
+
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <stdexcept>
+
+namespace hid {
+
+report_pipe::report_pipe(std::size_t capacity, std::size_t report_size, consumer fn)
+	: mask(std::bit_ceil(std::max<std::size_t>(capacity, 2)) - 1)
+	, slot_size(report_size)
+	, headers(std::make_unique<slot_header[]>(mask + 1))
+	, storage(std::make_unique_for_overwrite<std::uint8_t[]>((mask + 1) * report_size))
+	, fn(std::move(fn))
+{
+	if (report_size == 0) throw std::invalid_argument("Report buffer size is zero");
+	worker = detail::start_signal_blocked_thread([this] { run(); });
+}
+
+report_pipe::~report_pipe() {
+	if (worker.joinable()) {
+		head.fetch_or(closed_bit, std::memory_order_release);
+		head.notify_one();
+		worker.join();
+	}
+}
+
+bool report_pipe::push(const report_event& ev) noexcept {
+	if (consumer_failed.load(std::memory_order_relaxed)) return false;
+	const uint64_t h = head.load(std::memory_order_relaxed);
+	if (h - tail_seen > mask) {
+		tail_seen = tail.load(std::memory_order_acquire);
+		if (h - tail_seen > mask) {
+			++noverruns;
+			stats::count_overrun();
+			return false;
+		}
+	}
+	const std::size_t i = h & mask;
+	const std::size_t size = std::min(ev.data.size(), slot_size);
+	headers[i] = {ev.timestamp, ev.source, size};
+	if (size != 0) std::memcpy(storage.get() + i * slot_size, ev.data.data(), size);
+	head.store(h + 1, std::memory_order_release);
+	// Only enters the kernel when the consumer is actually waiting
+	head.notify_one();
+	++npushed;
+	peak = std::max<std::size_t>(peak, h + 1 - tail_seen);
+	return true;
+}
+
+void report_pipe::close() {
+	if (!worker.joinable()) return;
+	head.fetch_or(closed_bit, std::memory_order_release);
+	head.notify_one();
+	worker.join();
+	if (error) std::rethrow_exception(std::exchange(error, nullptr));
+}
+
+void report_pipe::run() noexcept {
+	uint64_t t = tail.load(std::memory_order_relaxed);
+	for (;;) {
+		const uint64_t raw = head.load(std::memory_order_acquire);
+		const uint64_t h = raw & ~closed_bit;
+		if (h == t) {
+			if (raw & closed_bit) return;
+			head.wait(raw, std::memory_order_acquire);
+			continue;
+		}
+		for (; t != h; ++t) {
+			const std::size_t i = t & mask;
+			if (!error) {
+				const slot_header& hdr = headers[i];
+				try {
+					fn({.source = hdr.source, .timestamp = hdr.timestamp,
+						.data = {storage.get() + i * slot_size, hdr.size}});
+				} catch (...) {
+					error = std::current_exception();
+					consumer_failed.store(true, std::memory_order_release);
+				}
+			}
+			tail.store(t + 1, std::memory_order_release);
+		}
+	}
+}
+
+} // namespace hid
@@ -0,0 +1,30 @@
+#include "hid_report_router.h"
+
+#include <format>
+#include <stdexcept>
+
+namespace hid {
+
+report_router::report_router(device_session& session)
+	: numbered(session.uses_report_ids())
+{
+	for (std::size_t id = 0; id < sizes.size(); ++id)
+		sizes[id] = static_cast<uint32_t>(session.report_size(static_cast<uint8_t>(id), device_session::field_kind::input));
+	max_size = session.max_report_size(device_session::field_kind::input);
+}
+
+std::size_t report_router::add_sink(sink fn) {
+	// Route slots are stored in a byte, 0 meaning "drop"
+	if (sinks.size() >= 255) throw std::length_error("Too many report sinks");
+	sinks.push_back(std::move(fn));
+	return sinks.size() - 1;
+}
+
+void report_router::route(uint8_t report_id, std::size_t sink_handle) {
+	if (sink_handle >= sinks.size()) throw std::out_of_range("Unknown report sink");
+	if (sizes[report_id] == 0)
+		throw std::invalid_argument(std::format("No input report with ID {} found.", report_id));
+	routes[report_id] = static_cast<uint8_t>(sink_handle + 1);
+}
+
+} // namespace hid
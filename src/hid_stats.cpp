@@ -0,0 +1,243 @@
+// Hot-path counters: registry, formatters and the reporter thread.
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "hid_stats.h"
+#include "priv/hid_thread.h"
+#include "priv/hidraw_priv.h"
+
+#include <cerrno>
+#include <cstdio>
+#include <format>
+#include <iterator>
+#include <stdexcept>
+#include <string_view>
+
+namespace hid::stats {
+
+namespace {
+
+using hidraw::throw_system_error;
+
+constexpr std::array<std::string_view, op_count> op_names = {"read", "write", "feature_get", "feature_set", "decode"};
+
+// Bucket i holds samples below 2^(i+1) ns
+constexpr uint64_t bucket_bound_ns(std::size_t i) noexcept {
+	return uint64_t{1} << (i + 1);
+}
+
+// Upper bound of the bucket holding the q-quantile sample (nearest rank),
+// capped at the largest sample seen
+uint64_t quantile_ns(const histogram& h, double q) noexcept {
+	const uint64_t count = h.count.load(std::memory_order_relaxed);
+	if (count == 0) return 0;
+	const uint64_t rank = std::max<uint64_t>(1, static_cast<uint64_t>(q * static_cast<double>(count) + 0.999999));
+	uint64_t seen = 0;
+	for (std::size_t i = 0; i < histogram::bucket_count; ++i) {
+		seen += h.buckets[i].load(std::memory_order_relaxed);
+		if (seen >= rank) return std::min(bucket_bound_ns(i), h.max_ns.load(std::memory_order_relaxed));
+	}
+	return h.max_ns.load(std::memory_order_relaxed);
+}
+
+uint64_t load(const std::atomic<uint64_t>& a) noexcept {
+	return a.load(std::memory_order_relaxed);
+}
+
+void append_text(std::string& out, const registry& r, const snapshot* since) {
+	const auto now = std::chrono::steady_clock::now();
+	const double seconds = since ? std::chrono::duration<double>(now - since->taken).count() : 0.0;
+	auto it = std::back_inserter(out);
+	out += "[Stats] Reports:";
+	bool any = false;
+	for (std::size_t id = 0; id < r.reports_by_id.size(); ++id) {
+		const uint64_t n = load(r.reports_by_id[id]);
+		if (n == 0) continue;
+		any = true;
+		std::format_to(it, " id {}: {}", id, n);
+		if (seconds > 0) std::format_to(it, " ({:.1f}/s)", static_cast<double>(n - since->reports_by_id[id]) / seconds);
+	}
+	if (!any) out += " none";
+	std::format_to(it, "\n[Stats] Bytes written: {}, short reads: {}, dropped: {}, overruns: {}\n",
+		load(r.bytes_written), load(r.short_reads), load(r.dropped), load(r.overruns));
+	for (std::size_t o = 0; o < op_count; ++o) {
+		const histogram& h = r.latency[o];
+		const uint64_t count = load(h.count);
+		if (count == 0) continue;
+		std::format_to(it, "[Stats] {}: {} calls, mean {:.3f} us, p50 < {:.3f} us, p99 < {:.3f} us, max {:.3f} us\n",
+			op_names[o], count, static_cast<double>(load(h.sum_ns)) / static_cast<double>(count) / 1e3,
+			static_cast<double>(quantile_ns(h, 0.50)) / 1e3, static_cast<double>(quantile_ns(h, 0.99)) / 1e3,
+			static_cast<double>(load(h.max_ns)) / 1e3);
+	}
+}
+
+void append_json(std::string& out, const registry& r) {
+	auto it = std::back_inserter(out);
+	out += "{\"reports\":{";
+	bool first = true;
+	for (std::size_t id = 0; id < r.reports_by_id.size(); ++id) {
+		const uint64_t n = load(r.reports_by_id[id]);
+		if (n == 0) continue;
+		std::format_to(it, "{}\"{}\":{}", first ? "" : ",", id, n);
+		first = false;
+	}
+	std::format_to(it, "}},\"bytes_written\":{},\"short_reads\":{},\"dropped\":{},\"overruns\":{},\"latency\":{{",
+		load(r.bytes_written), load(r.short_reads), load(r.dropped), load(r.overruns));
+	for (std::size_t o = 0; o < op_count; ++o) {
+		const histogram& h = r.latency[o];
+		std::format_to(it, "{}\"{}\":{{\"count\":{},\"sum_ns\":{},\"max_ns\":{},\"p50_ns\":{},\"p99_ns\":{},\"p999_ns\":{}}}",
+			o == 0 ? "" : ",", op_names[o], load(h.count), load(h.sum_ns), load(h.max_ns),
+			quantile_ns(h, 0.50), quantile_ns(h, 0.99), quantile_ns(h, 0.999));
+	}
+	out += "}}\n";
+}
+
+// Text exposition format, version 0.0.4
+void append_prometheus(std::string& out, const registry& r) {
+	auto it = std::back_inserter(out);
+	out += "# TYPE hidtool_reports_total counter\n";
+	for (std::size_t id = 0; id < r.reports_by_id.size(); ++id) {
+		const uint64_t n = load(r.reports_by_id[id]);
+		if (n != 0) std::format_to(it, "hidtool_reports_total{{report_id=\"{}\"}} {}\n", id, n);
+	}
+	auto counter = [&](std::string_view name, const std::atomic<uint64_t>& value) {
+		std::format_to(it, "# TYPE hidtool_{0} counter\nhidtool_{0} {1}\n", name, load(value));
+	};
+	counter("bytes_written_total", r.bytes_written);
+	counter("short_reads_total", r.short_reads);
+	counter("dropped_reports_total", r.dropped);
+	counter("overruns_total", r.overruns);
+	out += "# TYPE hidtool_op_duration_seconds histogram\n";
+	for (std::size_t o = 0; o < op_count; ++o) {
+		const histogram& h = r.latency[o];
+		const uint64_t count = load(h.count);
+		if (count == 0) continue;
+		uint64_t cumulative = 0;
+		for (std::size_t i = 0; i + 1 < histogram::bucket_count; ++i) {
+			cumulative += load(h.buckets[i]);
+			std::format_to(it, "hidtool_op_duration_seconds_bucket{{op=\"{}\",le=\"{:g}\"}} {}\n",
+				op_names[o], static_cast<double>(bucket_bound_ns(i)) / 1e9, cumulative);
+		}
+		std::format_to(it, "hidtool_op_duration_seconds_bucket{{op=\"{0}\",le=\"+Inf\"}} {1}\n"
+			"hidtool_op_duration_seconds_sum{{op=\"{0}\"}} {2:g}\n"
+			"hidtool_op_duration_seconds_count{{op=\"{0}\"}} {1}\n",
+			op_names[o], count, static_cast<double>(load(h.sum_ns)) / 1e9);
+	}
+}
+
+void write_all(int fd, std::string_view text) noexcept {
+	while (!text.empty()) {
+		const ::ssize_t n = ::send(fd, text.data(), text.size(), MSG_NOSIGNAL);
+		if (n < 0 && errno == EINTR) continue;
+		if (n <= 0) return; // the client went away; it only loses its copy
+		text.remove_prefix(static_cast<std::size_t>(n));
+	}
+}
+
+} // namespace
+
+registry& global() noexcept {
+	static registry r;
+	return r;
+}
+
+snapshot take_snapshot() noexcept {
+	snapshot s;
+	s.taken = std::chrono::steady_clock::now();
+	for (std::size_t id = 0; id < s.reports_by_id.size(); ++id) s.reports_by_id[id] = load(global().reports_by_id[id]);
+	return s;
+}
+
+void append(std::string& out, format fmt, const snapshot* since) {
+	switch (fmt) {
+	case format::text:       append_text(out, global(), since); break;
+	case format::json:       append_json(out, global()); break;
+	case format::prometheus: append_prometheus(out, global()); break;
+	}
+}
+
+reporter::reporter(options opts)
+	: opts(std::move(opts))
+{
+	if (::pipe2(wake_fds, O_CLOEXEC) < 0) throw_system_error("Failed to create pipe");
+	try {
+		if (this->opts.socket_path) {
+			const std::filesystem::path& path = *this->opts.socket_path;
+			::sockaddr_un addr{};
+			addr.sun_family = AF_UNIX;
+			if (path.native().size() >= sizeof(addr.sun_path))
+				throw std::runtime_error(std::format("Socket path too long: {}", path.string()));
+			std::ranges::copy(path.native(), addr.sun_path);
+			listen_fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+			if (listen_fd < 0) throw_system_error("Failed to create socket");
+			// A socket left behind by an earlier run would make bind() fail
+			std::error_code ec;
+			if (std::filesystem::is_socket(path, ec)) std::filesystem::remove(path, ec);
+			if (::bind(listen_fd, reinterpret_cast<const ::sockaddr*>(&addr), sizeof(addr)) < 0 || ::listen(listen_fd, 8) < 0)
+				throw_system_error("Failed to listen on {}", path.string());
+		}
+		worker = detail::start_signal_blocked_thread([this] { run(); });
+	} catch (...) {
+		if (listen_fd >= 0) ::close(listen_fd);
+		::close(wake_fds[0]);
+		::close(wake_fds[1]);
+		throw;
+	}
+}
+
+reporter::~reporter() {
+	const char stop = 0;
+	while (::write(wake_fds[1], &stop, 1) < 0 && errno == EINTR) {}
+	worker.join();
+	if (listen_fd >= 0) {
+		::close(listen_fd);
+		std::error_code ec;
+		std::filesystem::remove(*opts.socket_path, ec);
+	}
+	::close(wake_fds[0]);
+	::close(wake_fds[1]);
+
+	std::string text;
+	append(text, format::text);
+	std::fputs(text.c_str(), stderr);
+}
+
+void reporter::run() noexcept {
+	const int timeout = opts.interval.count() > 0 ? static_cast<int>(opts.interval.count()) : -1;
+	::pollfd fds[2] = {{wake_fds[0], POLLIN, 0}, {listen_fd, POLLIN, 0}};
+	const ::nfds_t nfds = listen_fd >= 0 ? 2 : 1;
+	snapshot last = take_snapshot();
+	auto next_dump = last.taken + opts.interval;
+	std::string text;
+	for (;;) {
+		int wait = timeout;
+		if (timeout >= 0) {
+			const auto left = std::chrono::ceil<std::chrono::milliseconds>(next_dump - std::chrono::steady_clock::now());
+			wait = static_cast<int>(std::max<std::chrono::milliseconds::rep>(left.count(), 0));
+		}
+		const int n = ::poll(fds, nfds, wait);
+		if (n < 0 && errno != EINTR) return;
+		if (fds[0].revents) return;
+		if (nfds == 2 && (fds[1].revents & POLLIN)) {
+			const int client = ::accept4(listen_fd, nullptr, nullptr, SOCK_CLOEXEC);
+			if (client >= 0) {
+				text.clear();
+				append(text, opts.socket_format);
+				write_all(client, text);
+				::close(client);
+			}
+		}
+		if (timeout >= 0 && std::chrono::steady_clock::now() >= next_dump) {
+			text.clear();
+			append(text, format::text, &last);
+			std::fputs(text.c_str(), stderr);
+			last = take_snapshot();
+			next_dump = last.taken + opts.interval;
+		}
+	}
+}
+
+} // namespace hid::stats
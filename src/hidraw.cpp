@@ -1,12 +1,14 @@
 #include <sys/ioctl.h>
 #include <fcntl.h>
+#include <poll.h>
 #include <unistd.h>
 #include <linux/input.h>
 
 #include "priv/hidraw_priv.h"
+#include "hex_codec.h"
+#include "hid_stats.h"
 
 #include <new>
-#include <vector>
 #include <system_error>
 #include <type_traits>
 #include <format>
@@ -16,6 +18,8 @@
 #include <algorithm>
 #include <cstring>
 #include <utility>
+#include <charconv>
+#include <limits>
 
 #define ASSERT_FD_OPENED() \
     do { \
@@ -26,12 +30,6 @@
 
 namespace hidraw {
 
-template<typename... Args>
-[[noreturn]] static inline void throw_system_error(
-    std::type_identity_t<std::format_string<Args...>> fmt, Args&&... args) noexcept(false) {
-    throw std::system_error(errno, std::system_category(), std::format(fmt, std::forward<Args>(args)...));
-}
-
 descriptor::descriptor(const descriptor& other)
     : ptr(other.ptr ? dump_report_descriptor(other.ptr) : nullptr)
 {}
@@ -50,17 +48,8 @@ std::string descriptor::to_hex() const {
     report_descriptor_head* head = to_report_descriptor_head(ptr);
     const std::size_t size = head->size;
     const unsigned char* data = std::launder(reinterpret_cast<const unsigned char*>(head + 1));
-    std::string result;
-    auto it = std::back_inserter(result);
-    it = std::format_to(it, "size: {}\n", size);
-    for (std::size_t i = 0; i < size; ++i) {
-        it = std::format_to(it, "{:02X} ", data[i]);
-        if ((i + 1) % 16 == 0) {
-            *it = '\n';
-            ++it;
-        }
-    }
-
+    std::string result = std::format("size: {}\n", size);
+    hid::hex::append(result, std::span(reinterpret_cast<const std::uint8_t*>(data), size), hid::hex::dump_layout);
     return result;
 }
 
@@ -72,15 +61,31 @@ std::span<const std::uint8_t> descriptor::to_bytes() const noexcept {
     return std::span<const std::uint8_t>(reinterpret_cast<const std::uint8_t*>(data), size);
 }
 
-void device::open(const std::filesystem::path& path) {
+void device::open(const std::filesystem::path& path, open_mode mode) {
     if (valid()) {
         throw std::runtime_error("Device already opened");
     }
 
-    fd = ::open(path.c_str(), O_RDWR | O_CLOEXEC);
+    const int flags = O_RDWR | O_CLOEXEC | (mode == open_mode::nonblocking ? O_NONBLOCK : 0);
+    fd = ::open(path.c_str(), flags);
     if (fd < 0) {
         throw_system_error("Failed to open device at '{}'", path.string());
     }
+    current_mode = mode;
+}
+
+void device::set_mode(open_mode mode) {
+    ASSERT_FD_OPENED();
+    if (mode == current_mode) return;
+    const int flags = ::fcntl(fd, F_GETFL);
+    if (flags < 0) {
+        throw_system_error("Failed to get file status flags");
+    }
+    const int new_flags = mode == open_mode::nonblocking ? (flags | O_NONBLOCK) : (flags & ~O_NONBLOCK);
+    if (new_flags != flags && ::fcntl(fd, F_SETFL, new_flags) < 0) {
+        throw_system_error("Failed to set file status flags");
+    }
+    current_mode = mode;
 }
 
 void device::close() {
@@ -178,7 +183,11 @@ void device::write(std::span<const std::uint8_t> data) {
     if (data.empty()) {
         throw std::invalid_argument("Data buffer is empty");
     }
-    ::ssize_t ret = ::write(fd, data.data(), data.size());
+    ::ssize_t ret;
+    {
+        hid::stats::scoped_timer timed(hid::stats::op::write);
+        ret = ::write(fd, data.data(), data.size());
+    }
     if (ret < 0) {
         throw_system_error("Failed to write output report");
     }
@@ -194,19 +203,95 @@ std::size_t device::read(std::span<std::uint8_t> data) {
     if (data.empty()) {
         throw std::invalid_argument("Data buffer is empty");
     }
-    ::ssize_t ret = ::read(fd, data.data(), data.size());
+    ::ssize_t ret;
+    {
+        // Includes the time spent blocked waiting for the device
+        hid::stats::scoped_timer timed(hid::stats::op::read);
+        ret = ::read(fd, data.data(), data.size());
+    }
     if (ret < 0) {
         throw_system_error("Failed to read input report");
     }
     return static_cast<std::size_t>(ret);
 }
 
+// Waits for fd to become readable; false on timeout. EINTR restarts the wait
+// with the remaining time. Hangups are left for the following read() to report.
+static bool wait_readable(int fd, std::chrono::milliseconds timeout) {
+    using clock = std::chrono::steady_clock;
+    const bool forever = timeout.count() < 0;
+    const auto deadline = clock::now() + (forever ? std::chrono::milliseconds::zero() : timeout);
+    ::pollfd pfd{fd, POLLIN, 0};
+    for (;;) {
+        int wait_ms = -1;
+        if (!forever) {
+            const auto left = std::chrono::ceil<std::chrono::milliseconds>(deadline - clock::now());
+            wait_ms = static_cast<int>(std::clamp<std::chrono::milliseconds::rep>(left.count(), 0, std::numeric_limits<int>::max()));
+        }
+        int ret = ::poll(&pfd, 1, wait_ms);
+        if (ret > 0) return true;
+        if (ret == 0) return false;
+        if (errno != EINTR) {
+            throw_system_error("Failed to poll device");
+        }
+    }
+}
+
+// One read() that reports EAGAIN as nullopt instead of throwing
+static std::optional<std::size_t> read_nowait(int fd, std::span<std::uint8_t> data) {
+    for (;;) {
+        ::ssize_t ret;
+        {
+            hid::stats::scoped_timer timed(hid::stats::op::read);
+            ret = ::read(fd, data.data(), data.size());
+        }
+        if (ret >= 0) return static_cast<std::size_t>(ret);
+        if (errno == EAGAIN) return std::nullopt;
+        if (errno != EINTR) {
+            throw_system_error("Failed to read input report");
+        }
+    }
+}
+
+std::optional<std::size_t> device::read_for(std::span<std::uint8_t> data, std::chrono::milliseconds timeout) {
+    ASSERT_FD_OPENED();
+    if (data.empty()) {
+        throw std::invalid_argument("Data buffer is empty");
+    }
+    if (!wait_readable(fd, timeout)) return std::nullopt;
+    // poll() said readable, so even a blocking read returns at once; a
+    // non-blocking one may still lose a race with another reader
+    return read_nowait(fd, data);
+}
+
+std::size_t device::drain(report_ring& ring) {
+    ASSERT_FD_OPENED();
+    if (ring.capacity() == 0 || ring.report_size() == 0) {
+        throw std::invalid_argument("Report ring has no storage");
+    }
+    const bool nonblocking = current_mode == open_mode::nonblocking;
+    std::size_t n = 0;
+    while (!ring.full()) {
+        // A blocking fd needs a zero-timeout poll before each read to avoid waiting
+        if (!nonblocking && !wait_readable(fd, std::chrono::milliseconds::zero())) break;
+        auto nread = read_nowait(fd, ring.back_slot());
+        if (!nread) break;
+        ring.push(*nread, report_ring::clock::now());
+        ++n;
+    }
+    return n;
+}
+
 void device::feature_get(std::span<std::uint8_t> data) {
     ASSERT_FD_OPENED();
     if (data.empty()) {
         throw std::invalid_argument("Data buffer is empty");
     }
-    ::ssize_t ret = ::ioctl(fd, HIDIOCGFEATURE(data.size()), data.data());
+    ::ssize_t ret;
+    {
+        hid::stats::scoped_timer timed(hid::stats::op::feature_get);
+        ret = ::ioctl(fd, HIDIOCGFEATURE(data.size()), data.data());
+    }
     if (ret < 0) {
         throw_system_error("Failed to get feature report");
     }
@@ -220,11 +305,39 @@ void device::feature_set(std::span<const std::uint8_t> data) {
     if (data.empty()) {
         throw std::invalid_argument("Data buffer is empty");
     }
-    std::vector<std::uint8_t> buf(data.begin(), data.end());
-    ::ssize_t ret = ::ioctl(fd, HIDIOCSFEATURE(buf.size()), buf.data());
+    // HIDIOCSFEATURE only copies from the buffer, so the caller's bytes are passed as is.
+    ::ssize_t ret;
+    {
+        hid::stats::scoped_timer timed(hid::stats::op::feature_set);
+        ret = ::ioctl(fd, HIDIOCSFEATURE(data.size()), const_cast<std::uint8_t*>(data.data()));
+    }
     if (ret < 0) {
         throw_system_error("Failed to set feature report");
     }
 }
 
+// Node number of "hidrawN", or -1 for other names
+static int hidraw_node_number(std::string_view name) {
+    constexpr std::string_view prefix = "hidraw";
+    if (!name.starts_with(prefix)) return -1;
+    name.remove_prefix(prefix.size());
+    int n = -1;
+    auto [ptr, ec] = std::from_chars(name.data(), name.data() + name.size(), n);
+    if (ec != std::errc{} || ptr != name.data() + name.size()) return -1;
+    return n;
+}
+
+std::vector<std::filesystem::path> enumerate_devices(const std::filesystem::path& dir) {
+    std::vector<std::pair<int, std::filesystem::path>> found;
+    for (const auto& entry : std::filesystem::directory_iterator(dir)) {
+        const int n = hidraw_node_number(entry.path().filename().native());
+        if (n >= 0) found.emplace_back(n, entry.path());
+    }
+    std::ranges::sort(found, {}, &std::pair<int, std::filesystem::path>::first);
+    std::vector<std::filesystem::path> paths;
+    paths.reserve(found.size());
+    for (auto& [n, path] : found) paths.push_back(std::move(path));
+    return paths;
+}
+
 } // namespace hidraw
@@ -0,0 +1,225 @@
+#include <sys/epoll.h>
+#include <sys/signalfd.h>
+#include <sys/inotify.h>
+#include <signal.h>
+#include <unistd.h>
+
+#include "hidraw_monitor.h"
+#include "priv/hidraw_priv.h"
+#include "priv/hidraw_uring.h"
+
+#include <array>
+#include <limits>
+#include <stdexcept>
+#include <string_view>
+
+namespace hidraw {
+
+namespace {
+
+constexpr std::uint64_t signal_token = std::numeric_limits<std::uint64_t>::max();
+constexpr std::uint64_t watch_bit = std::uint64_t{1} << 63;
+
+// Blocks SIGINT/SIGTERM for the current thread and owns a signalfd for them.
+class signal_guard
+{
+public:
+    signal_guard() {
+        ::sigemptyset(&mask);
+        ::sigaddset(&mask, SIGINT);
+        ::sigaddset(&mask, SIGTERM);
+        if (::pthread_sigmask(SIG_BLOCK, &mask, &old_mask) != 0) {
+            throw_system_error("Failed to block signals");
+        }
+        fd = ::signalfd(-1, &mask, SFD_CLOEXEC | SFD_NONBLOCK);
+        if (fd < 0) {
+            ::pthread_sigmask(SIG_SETMASK, &old_mask, nullptr);
+            throw_system_error("Failed to create signalfd");
+        }
+    }
+
+    ~signal_guard() {
+        ::close(fd);
+        ::pthread_sigmask(SIG_SETMASK, &old_mask, nullptr);
+    }
+
+    signal_guard(const signal_guard&) = delete;
+    signal_guard& operator=(const signal_guard&) = delete;
+
+    int native_handle() const noexcept { return fd; }
+
+    // Dequeues the delivered signals so they do not stay pending once unblocked
+    void consume() noexcept {
+        ::signalfd_siginfo info;
+        while (::read(fd, &info, sizeof(info)) == sizeof(info)) {}
+    }
+
+private:
+    ::sigset_t mask;
+    ::sigset_t old_mask;
+    int fd = -1;
+};
+
+void epoll_add(int epfd, int fd, std::uint64_t token) {
+    ::epoll_event ev{};
+    ev.events = EPOLLIN;
+    ev.data.u64 = token;
+    if (::epoll_ctl(epfd, EPOLL_CTL_ADD, fd, &ev) < 0) {
+        throw_system_error("Failed to register fd {} with epoll", fd);
+    }
+}
+
+} // namespace
+
+monitor::monitor(backend preferred) {
+    if (preferred == backend::io_uring) {
+        try {
+            uring = std::make_unique<uring_engine>();
+        } catch (const std::system_error&) {
+            // ENOSYS, EPERM (io_uring_disabled sysctl, seccomp) or ENOMEM: use epoll
+        }
+    }
+    if (uring) return;
+    epfd = ::epoll_create1(EPOLL_CLOEXEC);
+    if (epfd < 0) {
+        throw_system_error("Failed to create epoll instance");
+    }
+}
+
+monitor::~monitor() {
+    if (epfd >= 0) ::close(epfd);
+}
+
+std::size_t monitor::add(device& dev, std::size_t buffer_size) {
+    if (!dev.valid()) {
+        throw std::runtime_error("Device not opened");
+    }
+    if (buffer_size == 0) {
+        throw std::invalid_argument("Report buffer size is zero");
+    }
+    if (uring) {
+        // hidraw lacks FMODE_NOWAIT, so every io_uring read runs on an io-wq
+        // worker; a blocking one would park that worker until the next report
+        dev.set_mode(open_mode::nonblocking);
+        return uring->add(dev, buffer_size);
+    }
+    const std::size_t index = sources.size();
+    epoll_add(epfd, dev.native_handle(), index);
+    sources.emplace_back(source{&dev, report_ring(batch_capacity, buffer_size)});
+    return index;
+}
+
+void monitor::remove(std::size_t index) {
+    if (uring) return uring->remove(index);
+    if (index >= sources.size() || !sources[index]) return;
+    ::epoll_ctl(epfd, EPOLL_CTL_DEL, sources[index]->dev->native_handle(), nullptr);
+    sources[index].reset();
+}
+
+void monitor::watch(int fd, std::function<void()> on_readable) {
+    if (uring) return uring->watch(fd, std::move(on_readable));
+    epoll_add(epfd, fd, watch_bit | watches.size());
+    watches.push_back({fd, std::move(on_readable)});
+}
+
+void monitor::run(const report_callback& on_report, const disconnect_callback& on_disconnect) {
+    signal_guard signals;
+    if (uring) {
+        uring->run(signals.native_handle(), on_report, on_disconnect);
+        signals.consume();
+        return;
+    }
+    epoll_add(epfd, signals.native_handle(), signal_token);
+
+    auto disconnect = [&](std::size_t index) {
+        remove(index);
+        if (!on_disconnect) {
+            throw std::runtime_error("Device disconnected");
+        }
+        on_disconnect(index);
+    };
+
+    std::array<::epoll_event, 64> events;
+    for (;;) {
+        int n = ::epoll_wait(epfd, events.data(), static_cast<int>(events.size()), -1);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            throw_system_error("epoll_wait failed");
+        }
+        for (int i = 0; i < n; ++i) {
+            const ::epoll_event& ev = events[i];
+            const std::uint64_t token = ev.data.u64;
+            if (token == signal_token) {
+                ::epoll_ctl(epfd, EPOLL_CTL_DEL, signals.native_handle(), nullptr);
+                signals.consume();
+                return;
+            }
+            if (token & watch_bit) {
+                watches[token & ~watch_bit].on_readable();
+                continue;
+            }
+            // The source may have been removed by an earlier callback in this batch
+            if (!sources[token]) continue;
+            source& src = *sources[token];
+            if (ev.events & (EPOLLHUP | EPOLLERR)) {
+                disconnect(token);
+                continue;
+            }
+            src.ring.clear();
+            bool failed = false;
+            try {
+                src.dev->drain(src.ring);
+            } catch (const std::system_error&) {
+                if (!on_disconnect) throw;
+                failed = true;
+            }
+            // Reports drained before a failure are still delivered
+            while (!src.ring.empty()) {
+                on_report({.source = token, .timestamp = src.ring.front_timestamp(), .data = src.ring.front()});
+                // The callback may have removed this source, destroying its ring
+                if (!sources[token]) break;
+                src.ring.pop();
+            }
+            if (failed && sources[token]) disconnect(token);
+        }
+    }
+}
+
+hotplug_watcher::hotplug_watcher(const std::filesystem::path& dir)
+    : dir(dir)
+{
+    fd = ::inotify_init1(IN_CLOEXEC | IN_NONBLOCK);
+    if (fd < 0) {
+        throw_system_error("Failed to create inotify instance");
+    }
+    if (::inotify_add_watch(fd, dir.c_str(), IN_CREATE | IN_ATTRIB | IN_DELETE) < 0) {
+        ::close(fd);
+        throw_system_error("Failed to watch '{}'", dir.string());
+    }
+}
+
+hotplug_watcher::~hotplug_watcher() {
+    ::close(fd);
+}
+
+void hotplug_watcher::dispatch(const change_callback& on_change) {
+    alignas(::inotify_event) char buf[4096];
+    for (;;) {
+        ::ssize_t len = ::read(fd, buf, sizeof(buf));
+        if (len < 0) {
+            if (errno == EAGAIN) return;
+            if (errno == EINTR) continue;
+            throw_system_error("Failed to read inotify events");
+        }
+        for (char* p = buf; p < buf + len;) {
+            const auto* ev = reinterpret_cast<const ::inotify_event*>(p);
+            p += sizeof(::inotify_event) + ev->len;
+            if (ev->len == 0) continue;
+            const std::string_view name(ev->name);
+            if (!name.starts_with("hidraw")) continue;
+            on_change((ev->mask & IN_DELETE) ? change::removed : change::added, dir / name);
+        }
+    }
+}
+
+} // namespace hidraw
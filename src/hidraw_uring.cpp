@@ -0,0 +1,356 @@
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <poll.h>
+#include <unistd.h>
+
+#include "priv/hidraw_uring.h"
+#include "priv/hidraw_priv.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <stdexcept>
+
+namespace hidraw {
+
+namespace {
+
+// user_data layout: kind in the top two bits; reads carry source << 8 | slot,
+// with poll_bit set on the POLL_ADD at the head of a source's chain
+enum class token_kind : std::uint64_t { read = 0, watch = 1, signal = 2, ignored = 3 };
+
+constexpr std::uint64_t poll_bit = 0x80;
+
+constexpr std::uint64_t make_token(token_kind kind, std::uint64_t value) noexcept {
+    return (static_cast<std::uint64_t>(kind) << 62) | value;
+}
+constexpr token_kind kind_of(std::uint64_t token) noexcept { return static_cast<token_kind>(token >> 62); }
+constexpr std::uint64_t value_of(std::uint64_t token) noexcept { return token & ((std::uint64_t{1} << 62) - 1); }
+
+constexpr std::uint64_t read_token(std::size_t source, std::size_t slot) noexcept {
+    return make_token(token_kind::read, (static_cast<std::uint64_t>(source) << 8) | slot);
+}
+
+static_assert(monitor::uring_engine::reads_per_wakeup < poll_bit);
+
+int io_uring_setup(unsigned entries, ::io_uring_params* p) noexcept {
+    return static_cast<int>(::syscall(__NR_io_uring_setup, entries, p));
+}
+
+int io_uring_enter(int fd, unsigned to_submit, unsigned min_complete, unsigned flags) noexcept {
+    return static_cast<int>(::syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags, nullptr, 0));
+}
+
+int io_uring_register(int fd, unsigned opcode, const void* arg, unsigned nr_args) noexcept {
+    return static_cast<int>(::syscall(__NR_io_uring_register, fd, opcode, arg, nr_args));
+}
+
+template<typename T>
+T* ring_field(void* base, std::uint32_t offset) noexcept {
+    return reinterpret_cast<T*>(static_cast<char*>(base) + offset);
+}
+
+unsigned load_acquire(unsigned* p) noexcept {
+    return std::atomic_ref<unsigned>(*p).load(std::memory_order_acquire);
+}
+
+void store_release(unsigned* p, unsigned v) noexcept {
+    std::atomic_ref<unsigned>(*p).store(v, std::memory_order_release);
+}
+
+constexpr std::size_t align64(std::size_t n) noexcept { return (n + 63) & ~std::size_t{63}; }
+
+} // namespace
+
+monitor::uring_engine::uring_engine() {
+    ::io_uring_params params{};
+    ring_fd = io_uring_setup(queue_entries, &params);
+    if (ring_fd < 0) {
+        throw_system_error("io_uring_setup failed");
+    }
+    try {
+        if (!(params.features & IORING_FEAT_SINGLE_MMAP)) {
+            errno = ENOSYS;
+            throw_system_error("io_uring without IORING_FEAT_SINGLE_MMAP is not supported");
+        }
+        ring_map_size = std::max<std::size_t>(
+            params.sq_off.array + params.sq_entries * sizeof(unsigned),
+            params.cq_off.cqes + params.cq_entries * sizeof(::io_uring_cqe));
+        ring_map = ::mmap(nullptr, ring_map_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd, IORING_OFF_SQ_RING);
+        if (ring_map == MAP_FAILED) {
+            ring_map = nullptr;
+            throw_system_error("Failed to map io_uring rings");
+        }
+        sqes_size = params.sq_entries * sizeof(::io_uring_sqe);
+        void* sqe_map = ::mmap(nullptr, sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd, IORING_OFF_SQES);
+        if (sqe_map == MAP_FAILED) {
+            throw_system_error("Failed to map io_uring submission entries");
+        }
+        sqes = static_cast<::io_uring_sqe*>(sqe_map);
+
+        sq_head = ring_field<unsigned>(ring_map, params.sq_off.head);
+        sq_tail = ring_field<unsigned>(ring_map, params.sq_off.tail);
+        sq_mask = *ring_field<unsigned>(ring_map, params.sq_off.ring_mask);
+        sq_entries = params.sq_entries;
+        cq_head = ring_field<unsigned>(ring_map, params.cq_off.head);
+        cq_tail = ring_field<unsigned>(ring_map, params.cq_off.tail);
+        cq_mask = *ring_field<unsigned>(ring_map, params.cq_off.ring_mask);
+        cq_entries = params.cq_entries;
+        cqes = ring_field<::io_uring_cqe>(ring_map, params.cq_off.cqes);
+        // SQE i always sits in array slot i
+        unsigned* sq_array = ring_field<unsigned>(ring_map, params.sq_off.array);
+        for (unsigned i = 0; i < sq_entries; ++i) sq_array[i] = i;
+        local_tail = *sq_tail;
+
+        void* arena_map = ::mmap(nullptr, arena_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (arena_map == MAP_FAILED) {
+            throw_system_error("Failed to allocate io_uring buffer arena");
+        }
+        arena = static_cast<std::uint8_t*>(arena_map);
+        const ::iovec iov{arena, arena_size};
+        if (io_uring_register(ring_fd, IORING_REGISTER_BUFFERS, &iov, 1) < 0) {
+            throw_system_error("Failed to register io_uring buffers");
+        }
+        free_ranges.emplace_back(0, arena_size);
+    } catch (...) {
+        close();
+        throw;
+    }
+}
+
+monitor::uring_engine::~uring_engine() {
+    close();
+}
+
+void monitor::uring_engine::close() noexcept {
+    // Closing the ring cancels whatever is still in flight; registered pages
+    // stay pinned by the kernel until that completes, so unmapping is safe.
+    if (ring_fd >= 0) ::close(ring_fd);
+    if (arena) ::munmap(arena, arena_size);
+    if (sqes) ::munmap(sqes, sqes_size);
+    if (ring_map) ::munmap(ring_map, ring_map_size);
+    ring_fd = -1;
+    arena = nullptr;
+    sqes = nullptr;
+    ring_map = nullptr;
+}
+
+std::optional<std::size_t> monitor::uring_engine::allocate(std::size_t size) {
+    for (auto it = free_ranges.begin(); it != free_ranges.end(); ++it) {
+        if (it->second < size) continue;
+        const std::size_t offset = it->first;
+        it->first += size;
+        it->second -= size;
+        if (it->second == 0) free_ranges.erase(it);
+        return offset;
+    }
+    return std::nullopt;
+}
+
+void monitor::uring_engine::deallocate(std::size_t offset, std::size_t size) {
+    auto it = std::ranges::lower_bound(free_ranges, offset, {}, &std::pair<std::size_t, std::size_t>::first);
+    it = free_ranges.emplace(it, offset, size);
+    // Merge with the following and the preceding range
+    if (auto next = it + 1; next != free_ranges.end() && it->first + it->second == next->first) {
+        it->second += next->second;
+        free_ranges.erase(next);
+    }
+    if (it != free_ranges.begin()) {
+        if (auto prev = it - 1; prev->first + prev->second == it->first) {
+            prev->second += it->second;
+            free_ranges.erase(it);
+        }
+    }
+}
+
+::io_uring_sqe& monitor::uring_engine::next_sqe() {
+    if (local_tail - load_acquire(sq_head) == sq_entries) {
+        enter(0);
+    }
+    ::io_uring_sqe& sqe = sqes[local_tail & sq_mask];
+    std::memset(&sqe, 0, sizeof(sqe));
+    ++local_tail;
+    ++to_submit;
+    ++outstanding;
+    return sqe;
+}
+
+void monitor::uring_engine::submit_chain(std::size_t index) {
+    // A chain split across two submissions would lose its links
+    constexpr unsigned chain_length = reads_per_wakeup + 1;
+    if (sq_entries - (local_tail - load_acquire(sq_head)) < chain_length) {
+        enter(0);
+    }
+    source& src = *sources[index];
+    // Hard links keep the chain going past a cancelled poll or a read that
+    // fails or comes back short, which every report smaller than the slot does
+    ::io_uring_sqe& poll = next_sqe();
+    poll.opcode = IORING_OP_POLL_ADD;
+    poll.fd = src.fd;
+    poll.poll32_events = POLLIN;
+    poll.flags = IOSQE_IO_HARDLINK;
+    poll.user_data = read_token(index, 0) | poll_bit;
+    for (std::size_t slot = 0; slot < reads_per_wakeup; ++slot) {
+        ::io_uring_sqe& sqe = next_sqe();
+        sqe.opcode = IORING_OP_READ_FIXED;
+        sqe.fd = src.fd;
+        sqe.addr = reinterpret_cast<std::uint64_t>(arena + src.offset + slot * src.slot_size);
+        sqe.len = static_cast<std::uint32_t>(src.buffer_size);
+        sqe.off = static_cast<std::uint64_t>(-1); // current position; hidraw is not seekable
+        sqe.buf_index = 0;
+        if (slot + 1 < reads_per_wakeup) sqe.flags = IOSQE_IO_HARDLINK;
+        sqe.user_data = read_token(index, slot);
+    }
+    src.in_flight = chain_length;
+}
+
+void monitor::uring_engine::submit_poll(int fd, std::uint64_t token) {
+    ::io_uring_sqe& sqe = next_sqe();
+    sqe.opcode = IORING_OP_POLL_ADD;
+    sqe.fd = fd;
+    sqe.poll32_events = POLLIN;
+    sqe.user_data = token;
+}
+
+void monitor::uring_engine::submit_cancel(std::uint64_t target) {
+    ::io_uring_sqe& sqe = next_sqe();
+    sqe.opcode = IORING_OP_ASYNC_CANCEL;
+    sqe.fd = -1;
+    sqe.addr = target;
+    sqe.user_data = make_token(token_kind::ignored, 0);
+}
+
+void monitor::uring_engine::enter(unsigned wait_nr) {
+    store_release(sq_tail, local_tail);
+    for (;;) {
+        int ret = io_uring_enter(ring_fd, to_submit, wait_nr, wait_nr ? IORING_ENTER_GETEVENTS : 0);
+        if (ret >= 0) {
+            to_submit -= std::min<unsigned>(to_submit, static_cast<unsigned>(ret));
+            if (to_submit == 0 || wait_nr == 0) return;
+            continue;
+        }
+        if (errno == EINTR) continue;
+        throw_system_error("io_uring_enter failed");
+    }
+}
+
+std::size_t monitor::uring_engine::add(device& dev, std::size_t buffer_size) {
+    // Every request must be able to post its completion without overflowing the CQ
+    if (worst_case_cqes() + cqes_per_source > cq_entries) {
+        throw std::runtime_error("Too many devices for the io_uring queue");
+    }
+    const std::size_t slot_size = align64(buffer_size);
+    auto offset = allocate(slot_size * reads_per_wakeup);
+    if (!offset) {
+        throw std::runtime_error("io_uring buffer arena exhausted");
+    }
+    const std::size_t index = sources.size();
+    sources.emplace_back(source{dev.native_handle(), *offset, slot_size, buffer_size});
+    submit_chain(index);
+    enter(0);
+    return index;
+}
+
+std::size_t monitor::uring_engine::worst_case_cqes() const noexcept {
+    // Removed sources count until released, as their cancels are still pending
+    const auto live = std::count_if(sources.begin(), sources.end(), [](const auto& src) { return src.has_value(); });
+    // One more for the signalfd poll armed by run()
+    return static_cast<std::size_t>(live) * cqes_per_source + watches.size() + 1;
+}
+
+void monitor::uring_engine::release_source(std::size_t index) {
+    const source& src = *sources[index];
+    deallocate(src.offset, src.slot_size * reads_per_wakeup);
+    sources[index].reset();
+}
+
+void monitor::uring_engine::remove(std::size_t index) {
+    if (index >= sources.size() || !sources[index] || sources[index]->removed) return;
+    source& src = *sources[index];
+    src.removed = true;
+    if (src.in_flight == 0) {
+        release_source(index);
+        return;
+    }
+    // Slots are only reused once the whole chain has completed. Cancelling the
+    // poll is enough: the non-blocking reads linked behind it finish at once.
+    submit_cancel(read_token(index, 0) | poll_bit);
+}
+
+void monitor::uring_engine::watch(int fd, std::function<void()> on_readable) {
+    if (worst_case_cqes() + 1 > cq_entries) {
+        throw std::runtime_error("Too many watched fds for the io_uring queue");
+    }
+    const std::size_t index = watches.size();
+    watches.push_back({fd, std::move(on_readable)});
+    submit_poll(fd, make_token(token_kind::watch, index));
+}
+
+void monitor::uring_engine::run(int signal_fd, const report_callback& on_report, const disconnect_callback& on_disconnect) {
+    submit_poll(signal_fd, make_token(token_kind::signal, 0));
+    for (;;) {
+        enter(1);
+        unsigned head = *cq_head;
+        const unsigned tail = load_acquire(cq_tail);
+        bool stop = false;
+        for (; head != tail; ++head) {
+            const ::io_uring_cqe cqe = cqes[head & cq_mask];
+            // Free the CQ entry before callbacks, which may queue new requests
+            store_release(cq_head, head + 1);
+            --outstanding;
+            const std::uint64_t value = value_of(cqe.user_data);
+            switch (kind_of(cqe.user_data)) {
+                case token_kind::ignored:
+                    break;
+                case token_kind::signal:
+                    stop = true;
+                    break;
+                case token_kind::watch:
+                    watches[value].on_readable();
+                    submit_poll(watches[value].fd, cqe.user_data);
+                    break;
+                case token_kind::read: {
+                    const std::size_t index = static_cast<std::size_t>(value >> 8);
+                    const std::size_t slot = static_cast<std::size_t>(value & 0x7F);
+                    // The poll only gates the chain; each read completes after
+                    // the one before it, so reports are passed on in queue order.
+                    // -EAGAIN ends the reports queued at this wakeup.
+                    const bool is_read = !(value & poll_bit);
+                    const int res = cqe.res;
+                    if (is_read && !sources[index]->removed && res != -EAGAIN && res != -EINTR && res != -ECANCELED) {
+                        if (res < 0) {
+                            remove(index);
+                            if (!on_disconnect) {
+                                errno = -res;
+                                throw_system_error("Failed to read input report");
+                            }
+                            on_disconnect(index);
+                        } else {
+                            const source& src = *sources[index];
+                            on_report({
+                                .source = index,
+                                .timestamp = clock::now(),
+                                .data = std::span<const std::uint8_t>(arena + src.offset + slot * src.slot_size, static_cast<std::size_t>(res)),
+                            });
+                        }
+                    }
+                    // The callbacks may have added sources or removed this one;
+                    // a removed source is kept until its chain has completed
+                    source& src = *sources[index];
+                    if (--src.in_flight == 0) {
+                        if (src.removed) {
+                            release_source(index);
+                        } else {
+                            submit_chain(index);
+                        }
+                    }
+                    break;
+                }
+            }
+        }
+        if (stop) return;
+    }
+}
+
+} // namespace hidraw
@@ -5,12 +5,47 @@
 #include <optional>
 #include <stdexcept>
 #include <algorithm>
+#include <ranges>
 #include <format>
 #include <charconv>
 #include <fstream>
 #include <chrono>
+#include <memory>
+#include <cstdio>
+#include <thread>
+#include <cmath>
+#include <cstdint>
+#include <cerrno>
+#include <system_error>
+#include <limits>
+#include <bit>
+
+#include <map>
+#include <set>
+#include <random>
+#include <utility>
+
+#include <sched.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <time.h>
+#include <unistd.h>
 
 #include "hidraw.h"
+#include "hidraw_monitor.h"
+#include "hid_device_session.h"
+#include "hid_report_decoder.h"
+#include "hid_report_encoder.h"
+#include "hid_report_router.h"
+#include "hid_report_columns.h"
+#include "hid_report_delta.h"
+#include "hid_report_pipe.h"
+#include "hid_capture.h"
+#include "hid_descriptor_cache.h"
+#include "hid_parallel.h"
+#include "hid_stats.h"
+#include "hex_codec.h"
 #include "hid_report_desc.h"
 #include "hid_report_desc_dump.h"
 
@@ -19,22 +54,62 @@
  * Usage:
  *  dump <hidraw device path>
  *   - Dumps the HID report descriptor and device info.
- *  send <hidraw device path> <report id> <hex data file path>
+ *  dumphid <hidraw device path> | --from-file <file> | --dir <dir> [--check] [--threads <n>] [<output path>]
+ *   - Prints the HID report descriptor in a human-readable form, from a device or from descriptor files.
+ *   - With --dir, converts every file of a directory on a thread pool, one output file each.
+ *  send <hidraw device path> <report id> [--batch] [--interval-us <n>] <hex data file path>
+ *  send <hidraw device path> <report id> --set <usage>=<value>... [--count <n>] [--interval-us <n>]
  *   - Sends an output report to the device.
- *  recv <hidraw device path> <report id> [<output hex data file path>]
- *   - Receives an input report from the device.
+ *   - With --batch, every line of the hex file is one report; all lines are validated before the first write.
+ *   - With --set, builds the report from field values instead of a hex file and sends it <n> times.
+ *  recv <hidraw device path> <report id>[,<report id>...] [--stream] [--decode] [--io-uring] [--route <id>=<file>]
+ *       [--changes-only [--keyframe-ms <n>]] [--timeout-ms <n>] [<output hex data file path>]
+ *   - Receives an input report with the given ID from the device; reports with other IDs are skipped.
  *   - If <output hex data file path> is a directory, saves the report as a hex file in that directory named by timestamp.
  *   - If <output hex data file path> is not provided, prints to stdout.
+ *   - With --stream, keeps receiving reports until SIGINT, one timestamped line per report.
+ *     Reports are formatted and written on a second thread, fed through a lock-free ring.
+ *   - With --decode, prints field values named by usage instead of raw bytes (saved as .txt in a directory).
+ *   - With --stream --capture <file>, writes a binary capture file instead of text.
+ *   - With --timeout-ms, a single read fails if no report arrives within <n> milliseconds.
+ *   - With --stream --io-uring, reads through io_uring, falling back to epoll if unavailable.
+ *   - With --stream, several report IDs may be listed, and --route sends one ID to its own output file.
+ *   - With --stream --changes-only, writes only reports that changed, plus a full keyframe every --keyframe-ms.
+ *  monitor-all [--io-uring] [<output file path>]
+ *   - Streams input reports from every hidraw node, following hotplug, until SIGINT.
+ *  scan [--cache-dir <dir> | --no-cache] [<output file path>]
+ *   - Prints one JSON line per hidraw node: device info and a descriptor fingerprint and summary.
+ *   - Each distinct descriptor is parsed once; results are cached on disk by descriptor hash.
+ *  serve [--socket <path>]
+ *   - Runs newline-delimited commands from stdin or a Unix socket, keeping devices open between them.
+ *  inspect <capture file>
+ *   - Summarises a binary capture file.
+ *  replay <capture file> [--decode] [<output file path>]
+ *   - Prints the records of a binary capture file.
+ *  export <capture file> <report id> [--threads <n>] [<output csv path>]
+ *   - Decodes the input reports with the given ID of a capture file into CSV, one column per value.
  *  feature-get <hidraw device path> <report id> [<output hex data file path>]
  *   - Gets a feature report from the device.
  *   - If <output hex data file path> is a directory, saves the report as a hex file in that directory named by timestamp.
  *   - If <output hex data file path> is not provided, prints to stdout.
- *  feature-set <hidraw device path> <report id> <hex data file path>
+ *  feature-set <hidraw device path> <report id> [--batch] [--interval-us <n>] <hex data file path>
  *   - Sets a feature report to the device.
+ *   - --batch, --set, --count and --interval-us behave as for send.
+ *  bench <hidraw device path> <report id> [--mode output|feature-get|feature-set] [--count <n>] [--warmup <n>]
+ *        [--reply-id <id>] [--timeout-ms <n>] [--cpu <n>] [--fifo <priority>] [<hex data file path>]
+ *   - Times report round trips and prints p50/p99/p99.9/max latency and throughput.
+ *  trigger <hidraw device path> <report id> [--feature] [--reply-id <id>] [--count <n>] [--interval-us <n>]
+ *          [--jitter-us <n>] [--timeout-ms <n>] [--busy-poll] [--cpu <n>] [--fifo <priority>]
+ *          [--capture <file>] [<hex data file path>]
+ *   - Sends an output (or feature) report and waits for the first input report with the reply ID, <n> times.
+ *   - Prints the distribution of the send-to-reply latency; --capture records both sides with CLOCK_MONOTONIC_RAW.
+ *  --stats [--stats-interval-ms <n>] [--stats-socket <path>] [--stats-format text|json|prometheus] <command> ...
+ *   - Prints hot-path counters and syscall latency histograms to stderr (builds with counters only).
  */
 
-static int dump(const hidraw::device& dev) {
-    auto desc = dev.report_desc();
+static int dump(hid::device_session& session) {
+    const hidraw::device& dev = session.device();
+    const auto& desc = session.descriptor();
     std::println("[Name] {}", dev.raw_name());
     std::println("[Address] {}", dev.addr());
     std::println("[Info]");
@@ -44,12 +119,25 @@ static int dump(const hidraw::device& dev) {
     return 0;
 }
 
-static int dumphid(hidraw::device& dev, const std::optional<std::filesystem::path>& output_path = std::nullopt) {
-    auto desc = dev.report_desc();
-    std::string text = hid::descriptor_to_string(desc.to_bytes());
+static void save_descriptor_dump(std::span<const std::uint8_t> bytes, const std::filesystem::path& path) {
+    std::ofstream ofs(path, std::ios::binary);
+    if (!ofs) {
+        throw std::runtime_error(std::format("Failed to open output path: {}", path.string()));
+    }
+    try {
+        hid::write_descriptor(bytes, ofs);
+    } catch (const std::runtime_error&) {
+        throw std::runtime_error(std::format("Failed to write output path: {}", path.string()));
+    }
+}
 
+static int dumphid(std::span<const std::uint8_t> bytes, const std::optional<std::filesystem::path>& output_path = std::nullopt) {
     if (!output_path) {
-        std::println("{}", text);
+        hid::write_descriptor(bytes, stdout);
+        std::println();
+        if (std::fflush(stdout) != 0) {
+            throw std::system_error(errno, std::system_category(), "Failed to write descriptor dump");
+        }
         return 0;
     }
 
@@ -61,95 +149,251 @@ static int dumphid(hidraw::device& dev, const std::optional<std::filesystem::pat
         final_path = out / fname;
     }
 
-    std::ofstream ofs(final_path, std::ios::binary);
-    if (!ofs) {
-        throw std::runtime_error(std::format("Failed to open output path: {}", final_path.string()));
-    }
-    ofs << text;
+    save_descriptor_dump(bytes, final_path);
     std::println("[Saved human-readable HID descriptor] {}", final_path.string());
     return 0;
 }
 
-static std::size_t report_size_by_kind(hidraw::device& dev, uint8_t report_id, hid::report_descriptor_tree::field_kind kind) {
-    hidraw::descriptor desc = dev.report_desc();
-    auto tree = hid::report_descriptor_tree::parse(desc.to_bytes());
-    auto fields = tree.find_by_report_id(report_id);
-    std::size_t size = 0;
-    for (const auto& f : fields) {
-        if (f->kind == kind)
-            size += (f->report_size_bits * f->report_count + 7) / 8;
-    }
-    return size;
-}
-
-static void write_hex_output(std::span<const std::uint8_t> data, const std::optional<std::filesystem::path>& output_path) {
+// Prints text to stdout, or saves it to output_path; a directory gets a file
+// named by timestamp with the given extension.
+static void write_text_output(std::string_view text, const std::optional<std::filesystem::path>& output_path,
+    std::string_view extension) {
     if (!output_path) {
-        for (std::size_t i = 0; i < data.size(); ++i) {
-            std::print("{:02X} ", data[i]);
-            if ((i + 1) % 16 == 0) std::println();
-        }
-        if (data.size() % 16 != 0) std::println();
+        std::print("{}", text);
         return;
     }
     const auto& out = *output_path;
     std::filesystem::path final_path = out;
     if (std::filesystem::is_directory(out)) {
         auto now = std::chrono::system_clock::now();
-        auto fname = std::format("{:%Y%m%d_%H%M%S}.hex", now);
+        auto fname = std::format("{:%Y%m%d_%H%M%S}{}", now, extension);
         final_path = out / fname;
     }
     std::ofstream ofs(final_path, std::ios::binary);
     if (!ofs) {
         throw std::runtime_error(std::format("Failed to open output path: {}", final_path.string()));
     }
-    for (std::size_t i = 0; i < data.size(); ++i) {
-        ofs << std::format("{:02X} ", data[i]);
-        if ((i + 1) % 16 == 0) ofs << '\n';
+    if (!(ofs << text).flush()) {
+        throw std::runtime_error(std::format("Failed to write output path: {}", final_path.string()));
     }
-    if (data.size() % 16 != 0) ofs << '\n';
     std::println("[Saved] {}", final_path.string());
 }
 
-static std::vector<std::uint8_t> read_hex_file(const std::filesystem::path& path) {
+static void write_hex_output(std::span<const std::uint8_t> data, const std::optional<std::filesystem::path>& output_path) {
+    std::string text;
+    hid::hex::append(text, data, hid::hex::dump_layout);
+    if (data.size() % hid::hex::dump_layout.line_bytes != 0) text += '\n';
+    write_text_output(text, output_path, ".hex");
+}
+
+// Appends the bytes of one hex line to result. Returns false for blank and comment lines.
+static bool append_hex_line(std::string_view sv, std::vector<std::uint8_t>& result, const std::filesystem::path& path) {
+    auto pos = sv.find_first_not_of(" \t\r");
+    if (pos == std::string_view::npos) return false;
+    sv = sv.substr(pos);
+    if (sv.starts_with("//") || sv.starts_with("#") || sv.starts_with("size:"))
+        return false;
+    const std::size_t old_size = result.size();
+    result.resize(old_size + sv.size() / 2 + 1);
+    const auto decoded = hid::hex::decode(sv, result.data() + old_size);
+    result.resize(old_size + decoded.size);
+    if (!decoded.bad_token.empty())
+        throw std::runtime_error(std::format("Invalid hex byte '{}' in {}", decoded.bad_token, path.string()));
+    return true;
+}
+
+static std::ifstream open_hex_file(const std::filesystem::path& path) {
     std::ifstream ifs(path);
     if (!ifs) {
         throw std::runtime_error(std::format("Failed to open hex file: {}", path.string()));
     }
+    return ifs;
+}
+
+static std::vector<std::uint8_t> read_hex_file(const std::filesystem::path& path) {
+    std::ifstream ifs = open_hex_file(path);
     std::vector<std::uint8_t> result;
     std::string line;
     while (std::getline(ifs, line)) {
-        std::string_view sv(line);
-        auto pos = sv.find_first_not_of(" \t");
-        if (pos == std::string_view::npos) continue;
-        sv = sv.substr(pos);
-        if (sv.starts_with("//") || sv.starts_with("#") || sv.starts_with("size:"))
-            continue;
-        while (!sv.empty()) {
-            pos = sv.find_first_not_of(" \t,");
-            if (pos == std::string_view::npos) break;
-            sv = sv.substr(pos);
-            auto tok_end = sv.find_first_of(" \t,");
-            auto token = sv.substr(0, tok_end);
-            if (token.starts_with("0x") || token.starts_with("0X"))
-                token.remove_prefix(2);
-            uint8_t val = 0;
-            auto [ptr, ec] = std::from_chars(token.data(), token.data() + token.size(), val, 16);
-            if (ec != std::errc{} || ptr != token.data() + token.size())
-                throw std::runtime_error(std::format("Invalid hex byte '{}' in {}", token, path.string()));
-            result.push_back(val);
-            sv = (tok_end == std::string_view::npos) ? std::string_view{} : sv.substr(tok_end);
+        append_hex_line(line, result, path);
+    }
+    return result;
+}
+
+// Reads a descriptor saved as raw bytes, or as text in the format of
+// descriptor::to_hex() if the file starts with its "size:" line or is named *.hex.
+static std::vector<std::uint8_t> read_descriptor_file(const std::filesystem::path& path) {
+    std::ifstream ifs(path, std::ios::binary);
+    if (!ifs) {
+        throw std::runtime_error(std::format("Failed to open descriptor file: {}", path.string()));
+    }
+    std::vector<std::uint8_t> bytes{std::istreambuf_iterator<char>(ifs), std::istreambuf_iterator<char>()};
+    const std::string_view text(reinterpret_cast<const char*>(bytes.data()), bytes.size());
+    if (!text.starts_with("size:") && path.extension() != ".hex") {
+        return bytes;
+    }
+    std::vector<std::uint8_t> result;
+    for (const auto line : std::views::split(text, '\n')) {
+        append_hex_line(std::string_view(line.begin(), line.end()), result, path);
+    }
+    if (text.starts_with("size:")) {
+        // The file is not NUL-terminated, so parse within the first line only
+        std::string_view size = text.substr(0, text.find('\n')).substr(5);
+        size.remove_prefix(std::min(size.find_first_not_of(' '), size.size()));
+        std::size_t declared = 0;
+        const auto [ptr, ec] = std::from_chars(size.data(), size.data() + size.size(), declared);
+        if (ec == std::errc{} && declared != result.size()) {
+            throw std::runtime_error(std::format("Descriptor file declares {} bytes but holds {}", declared, result.size()));
         }
     }
     return result;
 }
 
-static int send(hidraw::device& dev, uint8_t report_id, const std::filesystem::path& hex_file_path) {
+// Reads one report per line into a single buffer of back-to-back frames, each
+// prefixed with report_id. Every line must carry exactly report_size bytes.
+static std::vector<std::uint8_t> read_hex_batch(const std::filesystem::path& path, uint8_t report_id, std::size_t report_size) {
+    std::ifstream ifs = open_hex_file(path);
+    std::vector<std::uint8_t> frames;
+    std::string line;
+    for (std::size_t line_no = 1; std::getline(ifs, line); ++line_no) {
+        const std::size_t frame_start = frames.size();
+        frames.push_back(report_id);
+        if (!append_hex_line(line, frames, path)) {
+            frames.pop_back();
+            continue;
+        }
+        const std::size_t got = frames.size() - frame_start - 1;
+        if (got != report_size) {
+            throw std::runtime_error(std::format(
+                "Data size mismatch at {}:{}: line has {} bytes, but report ID {} expects {} bytes.",
+                path.string(), line_no, got, report_id, report_size));
+        }
+    }
+    return frames;
+}
+
+// Calls write_frame(i) for i in [0, count), optionally paced, and prints throughput.
+template<typename Write>
+static int write_paced(uint8_t report_id, std::size_t count, std::size_t report_size,
+    std::chrono::microseconds interval, std::string_view what, Write&& write_frame) {
+    const auto start = std::chrono::steady_clock::now();
+    auto deadline = start;
+    for (std::size_t i = 0; i < count; ++i) {
+        if (interval.count() > 0 && i != 0) {
+            // Absolute deadlines keep the average rate exact even if one sleep overshoots.
+            deadline += interval;
+            std::this_thread::sleep_until(deadline);
+        }
+        write_frame(i);
+    }
+    const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+    const double secs = elapsed.count();
+    std::println("{} Report ID {}: {} reports ({} bytes) in {:.3f} ms, {:.1f} reports/s, {:.1f} KiB/s.",
+        what, report_id, count, count * report_size, secs * 1e3,
+        secs > 0 ? count / secs : 0.0, secs > 0 ? count * report_size / secs / 1024 : 0.0);
+    return 0;
+}
+
+// Writes every frame produced by read_hex_batch(), optionally paced, and prints throughput.
+template<typename Write>
+static int write_batch(const std::filesystem::path& hex_file_path, uint8_t report_id, std::size_t report_size,
+    std::chrono::microseconds interval, std::string_view what, Write&& write_frame) {
+    const auto frames = read_hex_batch(hex_file_path, report_id, report_size);
+    if (frames.empty()) {
+        throw std::runtime_error("Hex file contains no data.");
+    }
+
+    const std::size_t frame_size = report_size + 1;
+    const std::span<const std::uint8_t> all(frames);
+    return write_paced(report_id, frames.size() / frame_size, report_size, interval, what,
+        [&](std::size_t i) { write_frame(all.subspan(i * frame_size, frame_size)); });
+}
+
+// Parses a signed decimal or 0x-prefixed hexadecimal integer
+static bool parse_integer(std::string_view sv, int64_t& value) {
+    const bool negative = sv.starts_with('-');
+    if (negative) sv.remove_prefix(1);
+    int base = 10;
+    if (sv.starts_with("0x") || sv.starts_with("0X")) {
+        sv.remove_prefix(2);
+        base = 16;
+    }
+    uint64_t magnitude = 0;
+    auto [ptr, ec] = std::from_chars(sv.data(), sv.data() + sv.size(), magnitude, base);
+    if (sv.empty() || ec != std::errc{} || ptr != sv.data() + sv.size() || magnitude > uint64_t{INT64_MAX}) {
+        return false;
+    }
+    value = negative ? -static_cast<int64_t>(magnitude) : static_cast<int64_t>(magnitude);
+    return true;
+}
+
+// Parses "<usage>=<value>". The usage is "<page>:<usage>" in numbers, a name as
+// printed by recv --decode ("X", "Button 3"), or a bare number looked up in the report.
+static hid::report_encoder::setting parse_setting(std::string_view spec, const hid::report_encoder& encoder) {
+    const auto eq = spec.rfind('=');
+    int64_t value = 0;
+    if (eq == std::string_view::npos || !parse_integer(spec.substr(eq + 1), value)) {
+        throw std::runtime_error(std::format("Wrong setting, expected <usage>=<value>: {}", spec));
+    }
+    const std::string_view name = spec.substr(0, eq);
+    if (auto known = hid::find_usage_by_name(name)) {
+        return {known->first, known->second, value};
+    }
+    int64_t page = 0;
+    int64_t usage = 0;
+    if (const auto colon = name.find(':'); colon != std::string_view::npos) {
+        if (!parse_integer(name.substr(0, colon), page) || !parse_integer(name.substr(colon + 1), usage)
+            || page < 0 || page > 0xFFFF || usage < 0 || usage > 0xFFFF) {
+            throw std::runtime_error(std::format("Wrong usage, expected <page>:<usage>: {}", name));
+        }
+        return {static_cast<uint16_t>(page), static_cast<uint32_t>(usage), value};
+    }
+    if (!parse_integer(name, usage) || usage < 0 || usage > 0xFFFF) {
+        throw std::runtime_error(std::format("Unknown usage: {}", name));
+    }
+    const auto found = encoder.find_usage_page(static_cast<uint32_t>(usage));
+    if (!found) {
+        throw std::runtime_error(std::format("Report ID {} has no usage 0x{:X}", encoder.report_id(), usage));
+    }
+    return {*found, static_cast<uint32_t>(usage), value};
+}
+
+// Builds one report from --set usage=value pairs, starting from all zeros, and
+// writes it count times. Settings are resolved before the first write, so the
+// loop only copies a ready frame.
+template<typename Write>
+static int write_settings(hid::device_session& session, uint8_t report_id, hid::device_session::field_kind kind,
+    std::span<const std::string_view> specs, std::size_t count, std::chrono::microseconds interval,
+    std::string_view what, Write&& write_frame) {
+    const std::size_t report_size = session.report_size(report_id, kind);
+    if (report_size == 0) {
+        throw std::runtime_error(std::format("No {} report with ID {} found.", what, report_id));
+    }
+    const auto encoder = hid::report_encoder::compile(session.tree(), report_id, kind);
+    std::vector<hid::report_encoder::setting> settings;
+    for (const std::string_view spec : specs) {
+        settings.push_back(parse_setting(spec, encoder));
+    }
+    const auto assignments = encoder.resolve(settings);
+
+    auto buffer = session.make_report_buffer(report_id, kind);
+    encoder.encode(buffer.payload(), assignments);
+    if (count == 1) {
+        write_frame(buffer);
+        std::println("{} Report ID {} sent ({} bytes, {} values set).", what, report_id, report_size, assignments.size());
+        return 0;
+    }
+    return write_paced(report_id, count, report_size, interval, what, [&](std::size_t) { write_frame(buffer); });
+}
+
+static int send(hid::device_session& session, uint8_t report_id, const std::filesystem::path& hex_file_path) {
     auto data = read_hex_file(hex_file_path);
     if (data.empty()) {
         throw std::runtime_error("Hex file contains no data.");
     }
 
-    std::size_t output_size = report_size_by_kind(dev, report_id, hid::report_descriptor_tree::field_kind::output);
+    std::size_t output_size = session.report_size(report_id, hid::device_session::field_kind::output);
     if (output_size == 0) {
         throw std::runtime_error(std::format("No output report with ID {} found.", report_id));
     }
@@ -159,52 +403,645 @@ static int send(hidraw::device& dev, uint8_t report_id, const std::filesystem::p
             data.size(), report_id, output_size));
     }
 
-    std::vector<std::uint8_t> buffer(output_size + 1);
-    buffer[0] = report_id;
-    std::copy(data.begin(), data.end(), buffer.begin() + 1);
+    auto buffer = session.make_report_buffer(report_id, hid::device_session::field_kind::output);
+    std::ranges::copy(data, buffer.payload().begin());
 
-    dev.write(buffer);
+    session.device().write(buffer);
     std::println("Output Report ID {} sent ({} bytes).", report_id, output_size);
     return 0;
 }
 
-static int recv(hidraw::device& dev, uint8_t report_id, const std::optional<std::filesystem::path>& output_path = std::nullopt) {
-    std::size_t input_size = report_size_by_kind(dev, report_id, hid::report_descriptor_tree::field_kind::input);
+static int send_batch(hid::device_session& session, uint8_t report_id, const std::filesystem::path& hex_file_path,
+    std::chrono::microseconds interval) {
+    std::size_t output_size = session.report_size(report_id, hid::device_session::field_kind::output);
+    if (output_size == 0) {
+        throw std::runtime_error(std::format("No output report with ID {} found.", report_id));
+    }
+    return write_batch(hex_file_path, report_id, output_size, interval, "Output",
+        [&](std::span<const std::uint8_t> frame) { session.device().write(frame); });
+}
+
+// Buffered sink for streaming captures: stdout, or a file when a path is given.
+class stream_output
+{
+public:
+    explicit stream_output(const std::optional<std::filesystem::path>& path) {
+        if (path) {
+            file.reset(std::fopen(path->c_str(), "w"));
+            if (!file) {
+                throw std::runtime_error(std::format("Failed to open output path: {}", path->string()));
+            }
+            out = file.get();
+        }
+        // Reports arrive far faster than a terminal can take line-buffered writes.
+        std::setvbuf(out, nullptr, _IOFBF, 1 << 16);
+    }
+
+    void write(std::string_view text) {
+        std::fwrite(text.data(), 1, text.size(), out);
+        hid::stats::add_bytes_written(text.size());
+    }
+    void flush() { std::fflush(out); }
+
+private:
+    std::unique_ptr<std::FILE, decltype(&std::fclose)> file{nullptr, &std::fclose};
+    std::FILE* out = stdout;
+};
+
+// Appends "Name=value" pairs separated by ", " for every decoded value.
+static void append_decoded(std::string& out, std::span<const hid::report_decoder::value> values) {
+    for (std::size_t i = 0; i < values.size(); ++i) {
+        const auto& v = values[i];
+        if (i != 0) out += ", ";
+        hid::append_usage_name(out, v.usage_page, v.usage);
+        std::format_to(std::back_inserter(out), "={}", v.value);
+    }
+}
+
+struct recv_options {
+    bool stream = false;
+    bool decode = false;
+    std::optional<std::chrono::milliseconds> timeout;
+    bool io_uring = false;
+    std::vector<std::pair<uint8_t, std::filesystem::path>> routes; // --route <id>=<file>
+    std::optional<std::filesystem::path> capture_path;
+    std::optional<std::filesystem::path> output_path;
+    bool changes_only = false;
+    std::chrono::milliseconds keyframe_interval{1000}; // --keyframe-ms
+};
+
+// Reads until an input report with report_id arrives and returns its payload, or
+// nullopt once the deadline passes (never without one). Reports with other IDs are
+// skipped; on devices without report IDs every report matches and nothing is stripped.
+static std::optional<std::span<const std::uint8_t>> read_input_report(hidraw::device& dev, std::span<std::uint8_t> buffer,
+    uint8_t report_id, bool numbered, std::optional<std::chrono::steady_clock::time_point> deadline) {
+    for (;;) {
+        std::size_t nread;
+        if (deadline) {
+            const auto left = std::chrono::ceil<std::chrono::milliseconds>(*deadline - std::chrono::steady_clock::now());
+            auto got = dev.read_for(buffer, std::max(left, std::chrono::milliseconds::zero()));
+            if (!got) {
+                return std::nullopt;
+            }
+            nread = *got;
+        } else {
+            nread = dev.read(buffer);
+        }
+        const std::span<const std::uint8_t> data(buffer.data(), nread);
+        if (!numbered) {
+            return data;
+        }
+        if (!data.empty() && data[0] == report_id) {
+            return data.subspan(1);
+        }
+    }
+}
+
+static int recv(hid::device_session& session, uint8_t report_id, const recv_options& opts) {
+    std::size_t input_size = session.report_size(report_id, hid::device_session::field_kind::input);
     if (input_size == 0) {
         throw std::runtime_error(std::format("No input report with ID {} found.", report_id));
     }
 
-    std::vector<std::uint8_t> buffer(input_size + 1);
-    std::size_t nread = dev.read(buffer);
+    // Sized for the largest input report, since reports with other IDs arrive too
+    const bool numbered = session.uses_report_ids();
+    std::vector<std::uint8_t> buffer(session.max_report_size(hid::device_session::field_kind::input) + (numbered ? 1 : 0));
+    std::optional<std::chrono::steady_clock::time_point> deadline;
+    if (opts.timeout) {
+        deadline = std::chrono::steady_clock::now() + *opts.timeout;
+    }
+    const auto got = read_input_report(session.device(), buffer, report_id, numbered, deadline);
+    if (!got) {
+        throw std::runtime_error(std::format("No input report with ID {} within {} ms.", report_id, opts.timeout->count()));
+    }
+    const std::span<const std::uint8_t> payload = *got;
+    hid::stats::count_report(report_id);
+    if (payload.size() < input_size) {
+        hid::stats::count_short_read();
+    }
 
-    std::println("Input Report ID {} ({} bytes read):", report_id, nread > 0 ? nread - 1 : 0);
-    if (nread > 1) {
-        write_hex_output(std::span(buffer).subspan(1, nread - 1), output_path);
+    std::println("Input Report ID {} ({} bytes read):", report_id, payload.size());
+    if (payload.empty()) {
+        return 0;
+    }
+    if (opts.decode) {
+        auto decoder = hid::report_decoder::compile(session.tree(), report_id);
+        std::vector<hid::report_decoder::value> values(decoder.max_values());
+        std::string text;
+        append_decoded(text, std::span(values).first(decoder.decode(payload, values)));
+        text += '\n';
+        write_text_output(text, opts.output_path, ".txt");
+        return 0;
     }
+    write_hex_output(payload, opts.output_path);
     return 0;
 }
 
-static int feature_get(hidraw::device& dev, uint8_t report_id, const std::optional<std::filesystem::path>& output_path = std::nullopt) {
-    std::size_t feature_size = report_size_by_kind(dev, report_id, hid::report_descriptor_tree::field_kind::feature);
+// "[YYYY-MM-DD HH:MM:SS.nnnnnnnnn]" for wall-clock timestamps, "[seconds.nnnnnnnnn]" otherwise
+static void append_timestamp(std::string& out, uint64_t ns, hid::capture_clock clock) {
+    if (clock == hid::capture_clock::realtime) {
+        const std::chrono::sys_time<std::chrono::nanoseconds> tp{std::chrono::nanoseconds(ns)};
+        std::format_to(std::back_inserter(out), "[{:%F %T}]", tp);
+    } else {
+        std::format_to(std::back_inserter(out), "[{}.{:09}]", ns / 1'000'000'000, ns % 1'000'000'000);
+    }
+}
+
+static uint64_t to_ns(hidraw::monitor::clock::time_point tp) {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(tp.time_since_epoch()).count());
+}
+
+static constexpr std::string_view monitor_backend_name(hidraw::monitor::backend backend) noexcept {
+    return backend == hidraw::monitor::backend::io_uring ? "io_uring" : "epoll";
+}
+
+// "[timestamp] ID n (x bytes): <hex or decoded values>\n"
+static void append_report_line(std::string& line, const hid::report_router::routed_report& r, const hid::report_decoder* decoder,
+    std::span<hid::report_decoder::value> values) {
+    std::format_to(std::back_inserter(line), "[{:%F %T}] ID {} ({} bytes):", r.event.timestamp, r.report_id, r.payload.size());
+    if (decoder && !r.payload.empty()) {
+        line += ' ';
+        append_decoded(line, values.first(decoder->decode(r.payload, values)));
+    } else {
+        hid::hex::append(line, r.payload, hid::hex::inline_layout);
+    }
+    line += '\n';
+}
+
+// "[timestamp] ID n (x bytes) changed: <values>\n" for the decoded values that differ
+// from the previous report of the ID; false, leaving line alone, if none do
+static bool append_changed_line(std::string& line, const hid::report_router::routed_report& r, const hid::report_decoder& decoder,
+    hid::report_delta& delta, std::span<hid::report_decoder::value> values, std::span<hid::report_decoder::value> changed) {
+    const std::size_t n = delta.changed_values(decoder, values.first(decoder.decode(r.payload, values)), changed);
+    if (n == 0) {
+        return false;
+    }
+    std::format_to(std::back_inserter(line), "[{:%F %T}] ID {} ({} bytes) changed: ", r.event.timestamp, r.report_id, r.payload.size());
+    append_decoded(line, changed.first(n));
+    line += '\n';
+    return true;
+}
+
+// Reports buffered between the reader and formatter threads of recv --stream
+static constexpr std::size_t stream_pipe_capacity = 4096;
+
+static int recv_stream(hid::device_session& session, std::span<const uint8_t> report_ids, const recv_options& opts) {
+    const auto& output_path = opts.output_path;
+    hid::report_router router(session);
+
+    stream_output out(output_path);
+    std::optional<hid::capture_writer> capture;
+    if (opts.capture_path) {
+        capture.emplace(*opts.capture_path, session.descriptor().to_bytes(), session.uses_report_ids());
+    }
+
+    // Decoders for every routed ID, compiled up front
+    std::array<std::optional<hid::report_decoder>, 256> decoders;
+    std::vector<hid::report_decoder::value> values;
+    auto prepare_decoder = [&](uint8_t id) {
+        if (!opts.decode || decoders[id]) return;
+        decoders[id] = hid::report_decoder::compile(session.tree(), id);
+        values.resize(std::max(values.size(), decoders[id]->max_values()));
+    };
+    auto decoder_for = [&](uint8_t id) { return decoders[id] ? &*decoders[id] : nullptr; };
+
+    // --changes-only: repeats are dropped here, before any formatting or capture work
+    std::optional<hid::report_delta> delta;
+    std::vector<hid::report_decoder::value> changed;
+    std::size_t no_field_changes = 0;
+    if (opts.changes_only) {
+        delta.emplace(opts.keyframe_interval);
+    }
+
+    // Formats r into line; false if --changes-only leaves nothing to write
+    std::string line;
+    auto format_report = [&](const hid::report_router::routed_report& r) {
+        line.clear();
+        const auto* decoder = decoder_for(r.report_id);
+        if (!delta) {
+            append_report_line(line, r, decoder, values);
+            return true;
+        }
+        const auto verdict = delta->check(r.report_id, r.payload, hid::report_delta::clock::now());
+        if (verdict == hid::report_delta::verdict::repeat) {
+            return false;
+        }
+        if (!decoder || r.payload.empty()) {
+            append_report_line(line, r, decoder, values);
+            return true;
+        }
+        if (verdict == hid::report_delta::verdict::keyframe) {
+            // Brings the field state up to date; a keyframe still lists every value
+            delta->changed_values(*decoder, std::span(values).first(decoder->decode(r.payload, values)), changed);
+            append_report_line(line, r, decoder, values);
+            return true;
+        }
+        if (!append_changed_line(line, r, *decoder, *delta, values, changed)) {
+            ++no_field_changes;
+            return false;
+        }
+        return true;
+    };
+
+    std::size_t count = 0;
+    const std::size_t main_sink = router.add_sink([&](const hid::report_router::routed_report& r) {
+        ++count;
+        if (capture) {
+            if (!delta || delta->check(r.report_id, r.payload, hid::report_delta::clock::now()) != hid::report_delta::verdict::repeat) {
+                capture->append(to_ns(r.event.timestamp), r.event.data);
+            }
+            return;
+        }
+        if (format_report(r)) {
+            out.write(line);
+        }
+    });
+    for (uint8_t id : report_ids) {
+        router.route(id, main_sink);
+        prepare_decoder(id);
+    }
+
+    // --route outputs, each with its own file
+    std::vector<std::unique_ptr<stream_output>> route_outputs;
+    for (const auto& [id, path] : opts.routes) {
+        auto& route_out = *route_outputs.emplace_back(std::make_unique<stream_output>(path));
+        router.route(id, router.add_sink([&](const hid::report_router::routed_report& r) {
+            ++count;
+            if (format_report(r)) {
+                route_out.write(line);
+            }
+        }));
+        prepare_decoder(id);
+    }
+    changed.resize(2 * values.size());
+
+    hidraw::monitor mon(opts.io_uring ? hidraw::monitor::backend::io_uring : hidraw::monitor::backend::epoll);
+    session.device().set_mode(hidraw::open_mode::nonblocking);
+    // Sized for the largest input report so other IDs are never truncated
+    mon.add(session.device(), router.max_report_size());
+
+    // The monitor thread only copies reports into the pipe; routing, formatting,
+    // capture and file writes all run on the pipe's consumer thread.
+    hid::report_pipe pipe(stream_pipe_capacity, router.max_report_size(),
+        [&](const hidraw::monitor::report_event& ev) { router.dispatch(ev); });
+    std::println("Streaming input reports ({}), press Ctrl+C to stop.", monitor_backend_name(mon.active_backend()));
+    std::fflush(stdout);
+
+    // A failed consumer (e.g. a full disk) ends the stream with its error
+    mon.run([&](const hidraw::monitor::report_event& ev) {
+        if (!pipe.push(ev) && pipe.failed()) pipe.close();
+    });
+    pipe.close();
+
+    out.flush();
+    for (auto& route_out : route_outputs) route_out->flush();
+    std::println("Received {} input reports ({} of other IDs dropped).", count, router.dropped());
+    std::println("Pipe: peak {} of {} slots, {} reports lost to overruns.", pipe.high_water(), pipe.capacity(), pipe.overruns());
+    if (delta) {
+        std::println("Suppressed {} repeated reports and {} without changed fields.", delta->repeats(), no_field_changes);
+    }
+    if (capture) {
+        capture->flush();
+        std::println("[Saved capture] {} ({} bytes)", opts.capture_path->string(), capture->bytes_written());
+    } else if (output_path) {
+        std::println("[Saved] {}", output_path->string());
+    }
+    for (const auto& [id, path] : opts.routes) {
+        std::println("[Saved] ID {}: {}", id, path.string());
+    }
+    return 0;
+}
+
+static constexpr std::string_view record_kind_name(hid::record_kind kind) {
+    switch (kind) {
+        case hid::record_kind::input:       return "Input";
+        case hid::record_kind::output:      return "Output";
+        case hid::record_kind::feature_get: return "Feature-Get";
+        case hid::record_kind::feature_set: return "Feature-Set";
+    }
+    return "Unknown";
+}
+
+static int inspect(const std::filesystem::path& capture_path) {
+    hid::capture_reader reader(capture_path);
+    std::array<uint64_t, 4> by_kind{};
+    std::array<uint64_t, 256> by_report_id{};
+    uint64_t records = 0, payload_bytes = 0;
+    uint64_t first_ns = 0, last_ns = 0;
+    for (const hid::capture_record& rec : reader) {
+        if (records++ == 0) first_ns = rec.timestamp_ns;
+        last_ns = rec.timestamp_ns;
+        payload_bytes += rec.data.size();
+        if (static_cast<std::size_t>(rec.kind) < by_kind.size()) ++by_kind[static_cast<std::size_t>(rec.kind)];
+        if (reader.uses_report_ids() && !rec.data.empty()) ++by_report_id[rec.data[0]];
+    }
+
+    std::println("[Capture] {}", capture_path.string());
+    std::println("File size: {} bytes, descriptor: {} bytes, report IDs: {}, clock: {}",
+        reader.file_size(), reader.descriptor().size(), reader.uses_report_ids() ? "yes" : "no",
+        reader.clock() == hid::capture_clock::realtime ? "realtime" : "monotonic-raw");
+    std::println("Records: {} ({} report bytes)", records, payload_bytes);
+    for (std::size_t k = 0; k < by_kind.size(); ++k) {
+        if (by_kind[k]) std::println("  {}: {}", record_kind_name(static_cast<hid::record_kind>(k)), by_kind[k]);
+    }
+    for (std::size_t id = 0; id < by_report_id.size(); ++id) {
+        if (by_report_id[id]) std::println("  Report ID {}: {}", id, by_report_id[id]);
+    }
+    if (records > 1) {
+        const double secs = static_cast<double>(last_ns - first_ns) / 1e9;
+        std::println("Duration: {:.3f} s, {:.1f} records/s", secs, secs > 0 ? (records - 1) / secs : 0.0);
+    }
+    return 0;
+}
+
+static int replay(const std::filesystem::path& capture_path, bool decode, const std::optional<std::filesystem::path>& output_path) {
+    hid::capture_reader reader(capture_path);
+    std::optional<hid::report_descriptor_tree> tree;
+    // Compiled on first use per report ID
+    std::array<std::optional<hid::report_decoder>, 256> decoders;
+    std::vector<hid::report_decoder::value> values;
+    if (decode) {
+        tree = hid::report_descriptor_tree::parse(reader.descriptor());
+    }
+
+    stream_output out(output_path);
+    std::string line;
+    uint64_t count = 0;
+    for (const hid::capture_record& rec : reader) {
+        std::span<const std::uint8_t> payload = rec.data;
+        uint8_t report_id = 0;
+        if (reader.uses_report_ids() && !payload.empty()) {
+            report_id = payload[0];
+            payload = payload.subspan(1);
+        }
+        line.clear();
+        append_timestamp(line, rec.timestamp_ns, reader.clock());
+        std::format_to(std::back_inserter(line), " {} ID {} ({} bytes):",
+            record_kind_name(rec.kind), report_id, payload.size());
+        if (decode && rec.kind == hid::record_kind::input) {
+            auto& decoder = decoders[report_id];
+            if (!decoder) {
+                decoder = hid::report_decoder::compile(*tree, report_id);
+                values.resize(std::max(values.size(), decoder->max_values()));
+            }
+            line += ' ';
+            append_decoded(line, std::span(values).first(decoder->decode(payload, values)));
+        } else {
+            hid::hex::append(line, payload, hid::hex::inline_layout);
+        }
+        line += '\n';
+        out.write(line);
+        ++count;
+    }
+    out.flush();
+    std::println("Replayed {} records.", count);
+    return 0;
+}
+
+// Minimum reports staged per columnar decode; the CSV text of a batch is
+// written before the next one is staged, so memory stays flat on large captures.
+static constexpr std::size_t export_batch_rows = 1 << 16;
+
+static void append_csv_header(std::string& out, const hid::report_decoder& decoder) {
+    out += "timestamp";
+    for (const auto& s : decoder.slots()) {
+        out += ",\"";
+        if (s.is_array) {
+            hid::append_usage_page_name(out, s.usage_page);
+            out += " array";
+        } else {
+            hid::append_usage_name(out, s.usage_page, s.usage);
+        }
+        out += '"';
+    }
+    out += '\n';
+}
+
+static int export_columns(const std::filesystem::path& capture_path, uint8_t report_id, std::size_t threads,
+    const std::optional<std::filesystem::path>& output_path) {
+    hid::capture_reader reader(capture_path);
+    const auto tree = hid::report_descriptor_tree::parse(reader.descriptor());
+    const auto decoder = hid::report_decoder::compile(tree, report_id);
+    if (decoder.max_values() == 0) {
+        throw std::runtime_error(std::format("The capture's descriptor declares no input values for report ID {}", report_id));
+    }
+    const std::size_t stride = decoder.report_bytes();
+    // Every thread gets at least one chunk of each batch to decode and format
+    constexpr std::size_t chunk_rows = hid::report_columns::chunk_rows;
+    const std::size_t batch_rows = std::max(export_batch_rows, threads * chunk_rows);
+    hid::report_columns columns(decoder);
+    std::vector<std::uint8_t> batch;
+    batch.reserve(batch_rows * stride);
+    std::vector<uint64_t> timestamps;
+    timestamps.reserve(batch_rows);
+
+    stream_output out(output_path);
+    std::vector<std::string> chunk_text((batch_rows + chunk_rows - 1) / chunk_rows);
+    append_csv_header(chunk_text[0], decoder);
+    out.write(chunk_text[0]);
+    uint64_t rows = 0, short_reports = 0;
+    auto flush_batch = [&] {
+        columns.decode(batch, stride, threads);
+        const std::size_t chunks = (columns.rows() + chunk_rows - 1) / chunk_rows;
+        // Formatting costs more than decoding, so chunks are formatted in
+        // parallel too and written in order
+        hid::parallel_for(chunks, [&](std::size_t i) {
+            std::string& text = chunk_text[i];
+            text.clear();
+            const std::size_t last = std::min(columns.rows(), (i + 1) * chunk_rows);
+            for (std::size_t r = i * chunk_rows; r < last; ++r) {
+                std::format_to(std::back_inserter(text), "{}", timestamps[r]);
+                for (std::size_t c = 0; c < columns.columns().size(); ++c) {
+                    std::format_to(std::back_inserter(text), ",{}", columns.at(c, r));
+                }
+                text += '\n';
+            }
+        }, threads);
+        for (std::size_t i = 0; i < chunks; ++i) out.write(chunk_text[i]);
+        rows += columns.rows();
+        batch.clear();
+        timestamps.clear();
+    };
+    for (const hid::capture_record& rec : reader) {
+        if (rec.kind != hid::record_kind::input) continue;
+        std::span<const std::uint8_t> payload = rec.data;
+        if (reader.uses_report_ids()) {
+            if (payload.empty() || payload[0] != report_id) continue;
+            payload = payload.subspan(1);
+        }
+        if (payload.size() < stride) {
+            ++short_reports;
+            continue;
+        }
+        batch.insert(batch.end(), payload.begin(), payload.begin() + stride);
+        timestamps.push_back(rec.timestamp_ns);
+        if (timestamps.size() == batch_rows) flush_batch();
+    }
+    if (!timestamps.empty()) flush_batch();
+    out.flush();
+    std::println(stderr, "Exported {} reports of ID {} ({} columns), skipped {} short reports.",
+        rows, report_id, columns.columns().size(), short_reports);
+    return 0;
+}
+
+struct monitored_device {
+    std::filesystem::path path;
+    std::string tag;
+    hid::device_session session;
+    std::string name = {};
+    std::size_t input_size = 0;
+    bool numbered = false;
+};
+
+// Opens a node and runs every blocking ioctl and the descriptor parse up front,
+// so it can run on a worker thread before the device is registered.
+static std::unique_ptr<monitored_device> open_monitored_device(const std::filesystem::path& path) {
+    auto dev = std::make_unique<monitored_device>(monitored_device{
+        path, path.filename().string(), hid::device_session{hidraw::device(path, hidraw::open_mode::nonblocking)}});
+    dev->input_size = dev->session.max_report_size(hid::device_session::field_kind::input);
+    dev->numbered = dev->session.uses_report_ids();
+    dev->name = dev->session.device().raw_name();
+    return dev;
+}
+
+static int monitor_all(const std::optional<std::filesystem::path>& output_path, hidraw::monitor::backend backend) {
+    stream_output out(output_path);
+    hidraw::monitor mon(backend);
+    hidraw::hotplug_watcher hotplug;
+    // Indexed by monitor source; source indices are never reused.
+    std::vector<std::unique_ptr<monitored_device>> devices;
+
+    auto find_device = [&](const std::filesystem::path& path) -> std::optional<std::size_t> {
+        for (std::size_t i = 0; i < devices.size(); ++i) {
+            if (devices[i] && devices[i]->path == path) return i;
+        }
+        return std::nullopt;
+    };
+
+    // Nodes are retried on every attribute change, since udev may fix their
+    // permissions late, but each is reported as skipped once until it goes away.
+    std::set<std::filesystem::path> skipped;
+    auto skip = [&](const std::filesystem::path& path, std::string_view reason) {
+        if (skipped.insert(path).second) {
+            std::println("[Skipped] {}: {}", path.string(), reason);
+        }
+    };
+
+    auto add = [&](std::unique_ptr<monitored_device> dev) {
+        if (dev->input_size == 0) {
+            skip(dev->path, "no input reports");
+            return;
+        }
+        const std::size_t source = mon.add(dev->session.device(), dev->input_size + (dev->numbered ? 1 : 0));
+        devices.resize(source + 1);
+        skipped.erase(dev->path);
+        std::println("[Added] {} ({})", dev->path.string(), dev->name);
+        devices[source] = std::move(dev);
+    };
+
+    auto attach = [&](const std::filesystem::path& path) {
+        if (find_device(path)) return;
+        try {
+            add(open_monitored_device(path));
+        } catch (const std::exception& e) {
+            skip(path, e.what());
+        }
+    };
+
+    auto detach = [&](std::size_t source) {
+        std::println("[Removed] {}", devices[source]->path.string());
+        devices[source].reset();
+    };
+
+    // Startup opens all present nodes concurrently, then registers them in node order.
+    {
+        struct opened_device {
+            std::unique_ptr<monitored_device> dev;
+            std::string error;
+        };
+        const auto paths = hidraw::enumerate_devices();
+        std::vector<opened_device> opened(paths.size());
+        hid::parallel_for(paths.size(), [&](std::size_t i) {
+            try {
+                opened[i].dev = open_monitored_device(paths[i]);
+            } catch (const std::exception& e) {
+                opened[i].error = e.what();
+            }
+        });
+        for (std::size_t i = 0; i < paths.size(); ++i) {
+            if (!opened[i].dev) {
+                skip(paths[i], opened[i].error);
+                continue;
+            }
+            try {
+                add(std::move(opened[i].dev));
+            } catch (const std::exception& e) {
+                skip(paths[i], e.what());
+            }
+        }
+    }
+    mon.watch(hotplug.native_handle(), [&] {
+        hotplug.dispatch([&](hidraw::hotplug_watcher::change change, const std::filesystem::path& path) {
+            if (change == hidraw::hotplug_watcher::change::added) {
+                attach(path);
+            } else if (auto source = find_device(path)) {
+                mon.remove(*source);
+                detach(*source);
+            } else {
+                skipped.erase(path);
+            }
+        });
+    });
+    std::println("Monitoring all hidraw devices ({}), press Ctrl+C to stop.", monitor_backend_name(mon.active_backend()));
+    std::fflush(stdout);
+
+    std::size_t count = 0;
+    std::string line;
+    mon.run([&](const hidraw::monitor::report_event& ev) {
+        const monitored_device& dev = *devices[ev.source];
+        std::span<const std::uint8_t> payload = ev.data;
+        uint8_t report_id = 0;
+        if (dev.numbered && !payload.empty()) {
+            report_id = payload[0];
+            payload = payload.subspan(1);
+        }
+        hid::stats::count_report(report_id);
+        line.clear();
+        std::format_to(std::back_inserter(line), "[{:%F %T}] {} ID {} ({} bytes):", ev.timestamp, dev.tag, report_id, payload.size());
+        hid::hex::append(line, payload, hid::hex::inline_layout);
+        line += '\n';
+        out.write(line);
+        ++count;
+    }, detach);
+
+    out.flush();
+    std::println("Received {} input reports.", count);
+    if (output_path) {
+        std::println("[Saved] {}", output_path->string());
+    }
+    return 0;
+}
+
+static int feature_get(hid::device_session& session, uint8_t report_id, const std::optional<std::filesystem::path>& output_path = std::nullopt) {
+    std::size_t feature_size = session.report_size(report_id, hid::device_session::field_kind::feature);
     if (feature_size == 0) {
         throw std::runtime_error(std::format("No feature report with ID {} found.", report_id));
     }
-    std::vector<std::uint8_t> buffer(feature_size + 1);
-    buffer[0] = report_id;
-    dev.feature_get(buffer);
+    auto buffer = session.make_report_buffer(report_id, hid::device_session::field_kind::feature);
+    session.device().feature_get(buffer);
 
     std::println("Feature Report ID {} ({} bytes):", report_id, feature_size);
-    write_hex_output(std::span(buffer).subspan(1), output_path);
+    write_hex_output(buffer.payload(), output_path);
     return 0;
 }
 
-static int feature_set(hidraw::device& dev, uint8_t report_id, const std::filesystem::path& hex_file_path) {
+static int feature_set(hid::device_session& session, uint8_t report_id, const std::filesystem::path& hex_file_path) {
     auto data = read_hex_file(hex_file_path);
     if (data.empty()) {
         throw std::runtime_error("Hex file contains no data.");
     }
 
-    std::size_t feature_size = report_size_by_kind(dev, report_id, hid::report_descriptor_tree::field_kind::feature);
+    std::size_t feature_size = session.report_size(report_id, hid::device_session::field_kind::feature);
     if (feature_size == 0) {
         throw std::runtime_error(std::format("No feature report with ID {} found.", report_id));
     }
@@ -214,21 +1051,499 @@ static int feature_set(hidraw::device& dev, uint8_t report_id, const std::filesy
             data.size(), report_id, feature_size));
     }
 
-    std::vector<std::uint8_t> buffer(feature_size + 1);
-    buffer[0] = report_id;
-    std::copy(data.begin(), data.end(), buffer.begin() + 1);
+    auto buffer = session.make_report_buffer(report_id, hid::device_session::field_kind::feature);
+    std::ranges::copy(data, buffer.payload().begin());
 
-    dev.feature_set(buffer);
+    session.device().feature_set(buffer);
     std::println("Feature Report ID {} set ({} bytes).", report_id, feature_size);
     return 0;
 }
 
+static int feature_set_batch(hid::device_session& session, uint8_t report_id, const std::filesystem::path& hex_file_path,
+    std::chrono::microseconds interval) {
+    std::size_t feature_size = session.report_size(report_id, hid::device_session::field_kind::feature);
+    if (feature_size == 0) {
+        throw std::runtime_error(std::format("No feature report with ID {} found.", report_id));
+    }
+    return write_batch(hex_file_path, report_id, feature_size, interval, "Feature",
+        [&](std::span<const std::uint8_t> frame) { session.device().feature_set(frame); });
+}
+
+enum class bench_mode : uint8_t { output, feature_get, feature_set };
+
+struct bench_options {
+    bench_mode mode = bench_mode::output;
+    std::size_t count = 1000;
+    std::size_t warmup = 10;
+    std::optional<uint8_t> reply_id;             // output mode: input report that ends a round trip
+    std::chrono::milliseconds timeout{1000};     // output mode: wait for each reply
+    std::optional<int> cpu;
+    std::optional<int> fifo_priority;
+    std::optional<std::filesystem::path> hex_file_path;
+};
+
+// Pins the calling thread to one CPU and/or moves it to SCHED_FIFO, so that
+// scheduler noise does not show up in the latency tail. The previous affinity
+// and policy are restored on destruction, so a serve session keeps running
+// later requests with its own scheduling.
+class scoped_scheduling
+{
+public:
+    scoped_scheduling(std::optional<int> cpu, std::optional<int> fifo_priority) {
+        if (cpu) {
+            if (::sched_getaffinity(0, sizeof(old_set), &old_set) != 0) {
+                throw std::system_error(errno, std::system_category(), "Failed to read the CPU affinity");
+            }
+            ::cpu_set_t set;
+            CPU_ZERO(&set);
+            CPU_SET(*cpu, &set);
+            if (::sched_setaffinity(0, sizeof(set), &set) != 0) {
+                throw std::system_error(errno, std::system_category(), std::format("Failed to pin to CPU {}", *cpu));
+            }
+            pinned = true;
+        }
+        if (fifo_priority) {
+            old_policy = ::sched_getscheduler(0);
+            if (old_policy < 0 || ::sched_getparam(0, &old_param) != 0) {
+                const int err = errno;
+                old_policy = -1;
+                restore();
+                throw std::system_error(err, std::system_category(), "Failed to read the scheduling policy");
+            }
+            ::sched_param param{};
+            param.sched_priority = *fifo_priority;
+            if (::sched_setscheduler(0, SCHED_FIFO, &param) != 0) {
+                const int err = errno;
+                old_policy = -1;
+                restore();
+                throw std::system_error(err, std::system_category(),
+                    std::format("Failed to switch to SCHED_FIFO priority {} (requires CAP_SYS_NICE)", *fifo_priority));
+            }
+        }
+    }
+
+    ~scoped_scheduling() { restore(); }
+
+    scoped_scheduling(const scoped_scheduling&) = delete;
+    scoped_scheduling& operator=(const scoped_scheduling&) = delete;
+
+private:
+    void restore() noexcept {
+        if (old_policy >= 0) ::sched_setscheduler(0, old_policy, &old_param);
+        if (pinned) ::sched_setaffinity(0, sizeof(old_set), &old_set);
+        old_policy = -1;
+        pinned = false;
+    }
+
+    ::cpu_set_t old_set;
+    bool pinned = false;
+    int old_policy = -1;
+    ::sched_param old_param{};
+};
+
+// Nearest-rank percentile of sorted samples
+static uint64_t percentile(std::span<const uint64_t> sorted, double p) {
+    const auto rank = static_cast<std::size_t>(std::ceil(p * static_cast<double>(sorted.size())));
+    return sorted[std::clamp<std::size_t>(rank, 1, sorted.size()) - 1];
+}
+
+static int bench(hid::device_session& session, uint8_t report_id, const bench_options& opts) {
+    using field_kind = hid::device_session::field_kind;
+    const bool output = opts.mode == bench_mode::output;
+    const field_kind kind = output ? field_kind::output : field_kind::feature;
+    const std::string_view what = output ? "output" : "feature";
+    const std::size_t report_size = session.report_size(report_id, kind);
+    if (report_size == 0) {
+        throw std::runtime_error(std::format("No {} report with ID {} found.", what, report_id));
+    }
+
+    auto buffer = session.make_report_buffer(report_id, kind);
+    if (opts.hex_file_path) {
+        const auto data = read_hex_file(*opts.hex_file_path);
+        if (data.size() != report_size) {
+            throw std::runtime_error(std::format(
+                "Data size mismatch: file has {} bytes, but {} report ID {} expects {} bytes.",
+                data.size(), what, report_id, report_size));
+        }
+        std::ranges::copy(data, buffer.payload().begin());
+    }
+
+    const bool numbered = session.uses_report_ids();
+    const uint8_t reply_id = opts.reply_id.value_or(report_id);
+    std::vector<std::uint8_t> reply;
+    if (output) {
+        if (session.report_size(reply_id, field_kind::input) == 0) {
+            throw std::runtime_error(std::format("No input report with ID {} found to answer the output report.", reply_id));
+        }
+        reply.resize(session.max_report_size(field_kind::input) + (numbered ? 1 : 0));
+    }
+
+    auto& dev = session.device();
+    auto round_trip = [&](std::size_t i) {
+        switch (opts.mode) {
+            case bench_mode::output:
+                dev.write(buffer);
+                if (!read_input_report(dev, reply, reply_id, numbered, std::chrono::steady_clock::now() + opts.timeout)) {
+                    throw std::runtime_error(std::format(
+                        "No input report with ID {} within {} ms of output report {}.", reply_id, opts.timeout.count(), i));
+                }
+                break;
+            case bench_mode::feature_get:
+                dev.feature_get(buffer);
+                break;
+            case bench_mode::feature_set:
+                dev.feature_set(buffer);
+                break;
+        }
+    };
+
+    const scoped_scheduling scheduling(opts.cpu, opts.fifo_priority);
+    if (output) {
+        // Reports queued before the run would answer the first writes early
+        while (dev.read_for(reply, std::chrono::milliseconds::zero())) {}
+    }
+    for (std::size_t i = 0; i < opts.warmup; ++i) {
+        round_trip(i);
+    }
+
+    std::vector<uint64_t> samples(opts.count);
+    const auto start = std::chrono::steady_clock::now();
+    auto last = start;
+    for (std::size_t i = 0; i < opts.count; ++i) {
+        round_trip(i);
+        const auto now = std::chrono::steady_clock::now();
+        samples[i] = static_cast<uint64_t>(std::chrono::nanoseconds(now - last).count());
+        last = now;
+    }
+    const std::chrono::duration<double> elapsed = last - start;
+    std::ranges::sort(samples);
+
+    const double secs = elapsed.count();
+    const auto us = [](uint64_t ns) { return static_cast<double>(ns) / 1e3; };
+    if (output) {
+        std::println("Output Report ID {} -> Input Report ID {}: {} round trips in {:.3f} ms, {:.1f} round trips/s.",
+            report_id, reply_id, opts.count, secs * 1e3, secs > 0 ? opts.count / secs : 0.0);
+    } else {
+        std::println("Feature Report ID {} ({}): {} round trips in {:.3f} ms, {:.1f} round trips/s.",
+            report_id, opts.mode == bench_mode::feature_get ? "get" : "set", opts.count, secs * 1e3,
+            secs > 0 ? opts.count / secs : 0.0);
+    }
+    std::println("Latency (us): min {:.1f}, p50 {:.1f}, p99 {:.1f}, p99.9 {:.1f}, max {:.1f}",
+        us(samples.front()), us(percentile(samples, 0.50)), us(percentile(samples, 0.99)),
+        us(percentile(samples, 0.999)), us(samples.back()));
+    return 0;
+}
+
+struct trigger_options {
+    bool feature = false;                        // trigger with SET_REPORT on a feature report
+    std::optional<uint8_t> reply_id;
+    std::size_t count = 100;
+    std::chrono::microseconds interval{10000};   // between trigger starts
+    std::chrono::microseconds jitter{0};         // uniform random extra delay per trigger
+    std::chrono::milliseconds timeout{1000};     // wait for each reply
+    bool busy_poll = false;
+    std::optional<int> cpu;
+    std::optional<int> fifo_priority;
+    std::optional<std::filesystem::path> capture_path;
+    std::optional<std::filesystem::path> hex_file_path;
+};
+
+// CLOCK_MONOTONIC_RAW is not slewed by NTP, so intervals between two readings
+// are what the hardware counter measured; capture files mark it as their clock.
+static uint64_t monotonic_raw_ns() noexcept {
+    ::timespec ts;
+    ::clock_gettime(CLOCK_MONOTONIC_RAW, &ts);
+    return static_cast<uint64_t>(ts.tv_sec) * 1'000'000'000 + static_cast<uint64_t>(ts.tv_nsec);
+}
+
+static int trigger(hid::device_session& session, uint8_t report_id, const trigger_options& opts) {
+    using field_kind = hid::device_session::field_kind;
+    const field_kind kind = opts.feature ? field_kind::feature : field_kind::output;
+    const std::string_view what = opts.feature ? "Feature" : "Output";
+    const std::size_t report_size = session.report_size(report_id, kind);
+    if (report_size == 0) {
+        throw std::runtime_error(std::format("No {} report with ID {} found.", opts.feature ? "feature" : "output", report_id));
+    }
+    auto buffer = session.make_report_buffer(report_id, kind);
+    if (opts.hex_file_path) {
+        const auto data = read_hex_file(*opts.hex_file_path);
+        if (data.size() != report_size) {
+            throw std::runtime_error(std::format(
+                "Data size mismatch: file has {} bytes, but {} report ID {} expects {} bytes.",
+                data.size(), opts.feature ? "feature" : "output", report_id, report_size));
+        }
+        std::ranges::copy(data, buffer.payload().begin());
+    }
+
+    const bool numbered = session.uses_report_ids();
+    const uint8_t reply_id = opts.reply_id.value_or(report_id);
+    if (session.report_size(reply_id, field_kind::input) == 0) {
+        throw std::runtime_error(std::format("No input report with ID {} found to answer the {} report.", reply_id,
+            opts.feature ? "feature" : "output"));
+    }
+    std::vector<std::uint8_t> reply(session.max_report_size(field_kind::input) + (numbered ? 1 : 0));
+
+    std::optional<hid::capture_writer> capture;
+    if (opts.capture_path) {
+        capture.emplace(*opts.capture_path, session.descriptor().to_bytes(), numbered, hid::capture_clock::monotonic_raw);
+    }
+    // Captures hold reports as hidraw reads them: the report ID byte only on numbered devices
+    const std::span<const std::uint8_t> sent = numbered ? buffer.bytes() : buffer.payload();
+    const auto record_kind = opts.feature ? hid::record_kind::feature_set : hid::record_kind::output;
+
+    auto& dev = session.device();
+    // Returns the size of the next input report, polling without sleeping if busy_poll
+    auto next_report = [&](std::chrono::steady_clock::time_point deadline) -> std::optional<std::size_t> {
+        if (!opts.busy_poll) {
+            const auto left = std::chrono::ceil<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now());
+            return dev.read_for(reply, std::max(left, std::chrono::milliseconds::zero()));
+        }
+        do {
+            if (auto got = dev.try_read(reply)) return got;
+        } while (std::chrono::steady_clock::now() < deadline);
+        return std::nullopt;
+    };
+
+    const scoped_scheduling scheduling(opts.cpu, opts.fifo_priority);
+    std::minstd_rand rng{std::random_device{}()};
+    std::uniform_int_distribution<int64_t> jitter(0, opts.jitter.count());
+    std::vector<uint64_t> samples;
+    samples.reserve(opts.count);
+    uint64_t stale = 0;
+    auto base = std::chrono::steady_clock::now();
+    for (std::size_t i = 0; i < opts.count; ++i) {
+        if (i != 0) {
+            // The base advances by exactly one interval per trigger and each
+            // trigger waits a fresh jitter past it, so the jitter keeps triggers
+            // from locking to the device's polling interval without adding up.
+            // A loop that fell behind (a slow reply or a timeout) restarts the
+            // base from now instead of bursting to catch up.
+            base += opts.interval;
+            const auto now = std::chrono::steady_clock::now();
+            if (base < now) base = now;
+            std::this_thread::sleep_until(base + std::chrono::microseconds(jitter(rng)));
+        }
+        // Reports already queued would answer early
+        while (auto got = dev.try_read(reply)) {
+            ++stale;
+            if (capture) capture->append(monotonic_raw_ns(), std::span(reply.data(), *got));
+        }
+
+        const uint64_t tx_ns = monotonic_raw_ns();
+        if (opts.feature) {
+            dev.feature_set(buffer);
+        } else {
+            dev.write(buffer);
+        }
+        if (capture) capture->append(tx_ns, sent, record_kind);
+
+        const auto deadline = std::chrono::steady_clock::now() + opts.timeout;
+        while (auto got = next_report(deadline)) {
+            const uint64_t rx_ns = monotonic_raw_ns();
+            const std::span<const std::uint8_t> data(reply.data(), *got);
+            if (capture) capture->append(rx_ns, data);
+            if (!numbered || (!data.empty() && data[0] == reply_id)) {
+                samples.push_back(rx_ns - tx_ns);
+                break;
+            }
+        }
+    }
+    if (capture) capture->flush();
+
+    const std::size_t lost = opts.count - samples.size();
+    std::println("{} Report ID {} -> Input Report ID {}: {} triggers, {} replies, {} without a reply within {} ms, {} stale reports discarded.",
+        what, report_id, reply_id, opts.count, samples.size(), lost, opts.timeout.count(), stale);
+    if (capture) {
+        std::println("[Saved capture] {} ({} records, {} bytes)", opts.capture_path->string(), capture->records(), capture->bytes_written());
+    }
+    if (samples.empty()) {
+        return 1;
+    }
+
+    std::ranges::sort(samples);
+    const auto us = [](uint64_t ns) { return static_cast<double>(ns) / 1e3; };
+    double mean = 0, m2 = 0;
+    for (std::size_t i = 0; i < samples.size(); ++i) {
+        const double delta = us(samples[i]) - mean;
+        mean += delta / static_cast<double>(i + 1);
+        m2 += delta * (us(samples[i]) - mean);
+    }
+    std::println("Latency (us): min {:.1f}, p50 {:.1f}, p90 {:.1f}, p99 {:.1f}, p99.9 {:.1f}, max {:.1f}, mean {:.1f}, stddev {:.1f}",
+        us(samples.front()), us(percentile(samples, 0.50)), us(percentile(samples, 0.90)), us(percentile(samples, 0.99)),
+        us(percentile(samples, 0.999)), us(samples.back()), mean, std::sqrt(m2 / static_cast<double>(samples.size())));
+
+    // Power-of-two microsecond buckets between the fastest and slowest reply
+    std::println("Distribution:");
+    std::size_t first = 0;
+    for (unsigned b = static_cast<unsigned>(std::bit_width(samples.front() / 1000)); first < samples.size(); ++b) {
+        const uint64_t upper_us = uint64_t{1} << b;
+        const auto last = std::ranges::lower_bound(samples.begin() + first, samples.end(), upper_us * 1000) - samples.begin();
+        const std::size_t n = static_cast<std::size_t>(last) - first;
+        const std::size_t bar = (n * 50 + samples.size() - 1) / samples.size();
+        std::println("  {:>8} - {:<8} us {:>8} {}", b == 0 ? 0 : upper_us / 2, upper_us, n, std::string(bar, '#'));
+        first = static_cast<std::size_t>(last);
+    }
+    return 0;
+}
+
+// Appends sv as a JSON string literal
+static void append_json_string(std::string& out, std::string_view sv) {
+    out += '"';
+    for (char c : sv) {
+        switch (c) {
+            case '"':  out += "\\\""; break;
+            case '\\': out += "\\\\"; break;
+            case '\n': out += "\\n"; break;
+            case '\t': out += "\\t"; break;
+            default:
+                if (static_cast<unsigned char>(c) < 0x20) {
+                    std::format_to(std::back_inserter(out), "\\u{:04x}", static_cast<unsigned char>(c));
+                } else {
+                    out += c;
+                }
+        }
+    }
+    out += '"';
+}
+
+static constexpr std::string_view cache_origin_name(hid::descriptor_cache::origin from) noexcept {
+    switch (from) {
+        case hid::descriptor_cache::origin::parsed: return "parsed";
+        case hid::descriptor_cache::origin::disk: return "disk";
+        case hid::descriptor_cache::origin::memory: return "memory";
+    }
+    return "unknown";
+}
+
+// One scan record as a JSON line; failures are recorded rather than thrown.
+struct scan_record {
+    std::string line;
+    bool failed = false;
+    bool parsed = false;
+};
+
+static scan_record scan_device(const std::filesystem::path& path, hid::descriptor_cache& cache) {
+    scan_record rec;
+    std::string& line = rec.line;
+    line = "{\"path\":";
+    append_json_string(line, path.string());
+    try {
+        hidraw::device dev(path);
+        const hidraw::info info = dev.raw_info();
+        const std::string name = dev.raw_name();
+        const std::string phys = dev.addr();
+        const hidraw::descriptor desc = dev.report_desc();
+        const auto bytes = desc.to_bytes();
+        const auto entry = cache.lookup(bytes);
+        rec.parsed = entry.from == hid::descriptor_cache::origin::parsed;
+
+        std::format_to(std::back_inserter(line), ",\"bus\":\"0x{:04X}\",\"vendor\":\"0x{:04X}\",\"product\":\"0x{:04X}\",\"name\":",
+            info.bus_type(), info.vendor_id(), info.product_id());
+        append_json_string(line, name);
+        line += ",\"phys\":";
+        append_json_string(line, phys);
+        std::format_to(std::back_inserter(line), ",\"descriptor\":{{\"size\":{},\"hash\":\"{:016x}\",{}}},\"cache\":\"{}\"",
+            bytes.size(), hid::descriptor_hash(bytes), entry.summary, cache_origin_name(entry.from));
+        if (!entry.dump_path.empty()) {
+            line += ",\"dump\":";
+            append_json_string(line, entry.dump_path.string());
+        }
+    } catch (const std::exception& e) {
+        rec.failed = true;
+        line += ",\"error\":";
+        append_json_string(line, e.what());
+    }
+    line += "}\n";
+    return rec;
+}
+
+static int scan(const std::optional<std::filesystem::path>& cache_dir, const std::optional<std::filesystem::path>& output_path) {
+    stream_output out(output_path);
+    hid::descriptor_cache cache(cache_dir);
+    const auto paths = hidraw::enumerate_devices();
+    // Slow (e.g. Bluetooth) nodes are queried concurrently; records keep node order.
+    std::vector<scan_record> records(paths.size());
+    hid::parallel_for(paths.size(), [&](std::size_t i) { records[i] = scan_device(paths[i], cache); });
+
+    std::size_t failed = 0, parsed = 0;
+    for (const scan_record& rec : records) {
+        out.write(rec.line);
+        failed += rec.failed;
+        parsed += rec.parsed;
+    }
+    out.flush();
+    std::println(stderr, "Scanned {} devices ({} failed), parsed {} new descriptors.", records.size(), failed, parsed);
+    return 0;
+}
+
+struct dumphid_file_result {
+    std::string line;
+    bool failed = false;
+};
+
+// Dumps one descriptor file to output_dir/<file name>.txt, or only parses it
+// with check, and describes the outcome in one line.
+static dumphid_file_result dumphid_file(const std::filesystem::path& path, const std::optional<std::filesystem::path>& output_dir, bool check) {
+    dumphid_file_result result;
+    try {
+        const auto bytes = read_descriptor_file(path);
+        if (check) {
+            const auto tree = hid::report_descriptor_tree::parse(bytes);
+            result.line = std::format("{}: ok ({} bytes, {} collections, {} fields)",
+                path.string(), bytes.size(), tree.collections().size() - 1, tree.fields().size());
+        } else {
+            std::filesystem::path final_path = *output_dir / path.filename();
+            final_path += ".txt";
+            save_descriptor_dump(bytes, final_path);
+            result.line = std::format("[Saved human-readable HID descriptor] {}", final_path.string());
+        }
+    } catch (const std::exception& e) {
+        result.failed = true;
+        result.line = std::format("{}: {}", path.string(), e.what());
+    }
+    return result;
+}
+
+// Dumps or checks every regular file of input_dir on up to threads threads.
+// Results are printed in file name order once all files are done.
+static int dumphid_dir(const std::filesystem::path& input_dir, const std::optional<std::filesystem::path>& output_dir,
+    bool check, std::size_t threads) {
+    std::vector<std::filesystem::path> paths;
+    for (const auto& entry : std::filesystem::directory_iterator(input_dir)) {
+        if (entry.is_regular_file()) paths.push_back(entry.path());
+    }
+    std::ranges::sort(paths);
+    if (output_dir) {
+        std::filesystem::create_directories(*output_dir);
+    }
+
+    std::vector<dumphid_file_result> results(paths.size());
+    hid::parallel_for(paths.size(), [&](std::size_t i) { results[i] = dumphid_file(paths[i], output_dir, check); }, threads);
+
+    std::size_t failed = 0;
+    for (const auto& result : results) {
+        // Saved paths only are noise for a large corpus; failures and check results are the output
+        if (check || result.failed) std::println("{}", result.line);
+        failed += result.failed;
+    }
+    std::println(stderr, "{} {} descriptors ({} failed).", check ? "Checked" : "Dumped", results.size(), failed);
+    return failed == 0 ? 0 : 1;
+}
+
 struct interact {
     std::string_view command;
-    int (*handler)(const interact& self, hidraw::device& dev, char* rest_args[]);
+    int (*handler)(const interact& self, hid::device_session& session, char* rest_args[]);
     std::string_view usage_message;
+    // Set instead of handler for commands that do not take a device path; set
+    // as well for commands that also run without a device when their first
+    // argument is an option
+    int (*global_handler)(const interact& self, char* rest_args[]) = nullptr;
 };
 
+static bool runs_without_device(const interact& cmd, const char* first_arg) noexcept {
+    return cmd.global_handler && (!cmd.handler || (first_arg && std::string_view(first_arg).starts_with("--")));
+}
+
 class wrong_usage_exception : public std::runtime_error
 {
 public:
@@ -248,16 +1563,16 @@ private:
     const interact& cmd;
 };
 
-static int dump_handler(const interact& self, hidraw::device& dev, char* rest_args[]) {
-    return dump(dev);
+static int dump_handler(const interact& self, hid::device_session& session, char* rest_args[]) {
+    return dump(session);
 }
 
-static int dumphid_handler(const interact& self, hidraw::device& dev, char* rest_args[]) {
+static int dumphid_handler(const interact& self, hid::device_session& session, char* rest_args[]) {
     std::optional<std::filesystem::path> output_path = std::nullopt;
     if (rest_args[0]) {
         output_path = rest_args[0];
     }
-    return dumphid(dev, output_path);
+    return dumphid(session.descriptor().to_bytes(), output_path);
 }
 
 static uint8_t parse_report_id(const interact& self, std::string_view arg) {
@@ -281,28 +1596,216 @@ static uint8_t parse_report_id(const interact& self, std::string_view arg) {
     return value;
 }
 
-static int send_handler(const interact& self, hidraw::device& dev, char* rest_args[]) {
+static uint64_t parse_unsigned(const interact& self, const char* arg, std::string_view what) {
+    if (!arg) {
+        throw wrong_usage_exception(self, std::format("Missing value for {}", what));
+    }
+    const std::string_view sv = arg;
+    uint64_t value = 0;
+    auto [ptr, ec] = std::from_chars(sv.data(), sv.data() + sv.size(), value);
+    if (sv.empty() || ec != std::errc{} || ptr != sv.data() + sv.size()) {
+        throw wrong_usage_exception(self, std::format("Wrong value for {}: {}", what, sv));
+    }
+    return value;
+}
+
+// dumphid --from-file <file> | --dir <dir> [--check] [--threads <n>] [<output path>]
+static int dumphid_offline_handler(const interact& self, char* rest_args[]) {
+    std::optional<std::filesystem::path> from_file, from_dir;
+    bool check = false;
+    std::size_t threads = std::max(std::thread::hardware_concurrency(), 1u);
+    char** rest = rest_args;
+    for (; rest[0] && std::string_view(rest[0]).starts_with("--"); ++rest) {
+        const std::string_view opt = rest[0];
+        if (opt == "--from-file" || opt == "--dir") {
+            if (!rest[1]) {
+                throw wrong_usage_exception(self, std::format("Missing path for {}", opt));
+            }
+            (opt == "--dir" ? from_dir : from_file) = *++rest;
+        } else if (opt == "--check") {
+            check = true;
+        } else if (opt == "--threads") {
+            threads = parse_unsigned(self, rest[1], "--threads");
+            if (threads == 0) {
+                throw wrong_usage_exception(self, "--threads must be at least 1");
+            }
+            ++rest;
+        } else {
+            throw wrong_usage_exception(self, std::format("Unknown option for dumphid command: {}", opt));
+        }
+    }
+    if (from_file.has_value() == from_dir.has_value()) {
+        throw wrong_usage_exception(self, "Give exactly one of --from-file and --dir.");
+    }
+    std::optional<std::filesystem::path> output_path;
+    if (rest[0]) {
+        output_path = rest[0];
+    }
+
+    if (from_file) {
+        if (!check) {
+            return dumphid(read_descriptor_file(*from_file), output_path);
+        }
+        const auto result = dumphid_file(*from_file, std::nullopt, true);
+        std::println("{}", result.line);
+        return result.failed ? 1 : 0;
+    }
+    if (!check && !output_path) {
+        throw wrong_usage_exception(self, "Missing output directory for --dir.");
+    }
+    if (output_path && std::filesystem::exists(*output_path) && std::filesystem::equivalent(*output_path, *from_dir)) {
+        throw wrong_usage_exception(self, "The output directory must differ from the descriptor directory.");
+    }
+    return dumphid_dir(*from_dir, check ? std::nullopt : output_path, check, threads);
+}
+
+struct write_options {
+    bool batch = false;
+    std::chrono::microseconds interval{0};
+    std::vector<std::string_view> settings; // --set <usage>=<value>, in order
+    std::size_t count = 1;
+    std::filesystem::path hex_file_path;
+};
+
+// Parses [--batch] [--interval-us <n>] <hex data file path>
+//     or --set <usage>=<value>... [--count <n>] [--interval-us <n>]
+static write_options parse_write_options(const interact& self, char* rest[]) {
+    write_options opts;
+    bool has_count = false;
+    for (; rest[0] && std::string_view(rest[0]).starts_with("--"); ++rest) {
+        const std::string_view opt = rest[0];
+        if (opt == "--batch") {
+            opts.batch = true;
+        } else if (opt == "--set") {
+            if (!rest[1]) {
+                throw wrong_usage_exception(self, "Missing <usage>=<value> for --set");
+            }
+            opts.settings.emplace_back(rest[1]);
+            ++rest;
+        } else if (opt == "--count") {
+            opts.count = parse_unsigned(self, rest[1], opt);
+            has_count = true;
+            ++rest;
+        } else if (opt == "--interval-us") {
+            opts.interval = std::chrono::microseconds(parse_unsigned(self, rest[1], opt));
+            ++rest;
+        } else {
+            throw wrong_usage_exception(self, std::format("Unknown option for {} command: {}", self.command, opt));
+        }
+    }
+    if (!opts.settings.empty()) {
+        if (opts.batch || rest[0]) {
+            throw wrong_usage_exception(self, "--set replaces --batch and the hex data file");
+        }
+        if (opts.count == 0) {
+            throw wrong_usage_exception(self, "--count must be at least 1");
+        }
+        return opts;
+    }
+    if (has_count) {
+        throw wrong_usage_exception(self, "--count requires --set");
+    }
+    if (!rest[0]) {
+        throw wrong_usage_exception(self, std::format("Missing hex data file path for {} command.", self.command));
+    }
+    if (opts.interval.count() > 0 && !opts.batch) {
+        throw wrong_usage_exception(self, "--interval-us requires --batch or --set");
+    }
+    opts.hex_file_path = rest[0];
+    return opts;
+}
+
+static int send_handler(const interact& self, hid::device_session& session, char* rest_args[]) {
     if (!rest_args[0] || !rest_args[1]) {
         throw wrong_usage_exception(self, "Missing arguments for send command.");
     }
     uint8_t report_id = parse_report_id(self, rest_args[0]);
-    std::filesystem::path hex_file_path = rest_args[1];
-    return send(dev, report_id, hex_file_path);
+    const write_options opts = parse_write_options(self, &rest_args[1]);
+    if (!opts.settings.empty()) {
+        return write_settings(session, report_id, hid::device_session::field_kind::output, opts.settings, opts.count,
+            opts.interval, "Output", [&](const hidraw::report_buffer& report) { session.device().write(report); });
+    }
+    if (opts.batch) {
+        return send_batch(session, report_id, opts.hex_file_path, opts.interval);
+    }
+    return send(session, report_id, opts.hex_file_path);
 }
 
-static int recv_handler(const interact& self, hidraw::device& dev, char* rest_args[]) {
+static int recv_handler(const interact& self, hid::device_session& session, char* rest_args[]) {
     if (!rest_args[0]) {
         throw wrong_usage_exception(self, "Missing arguments for recv command.");
     }
-    uint8_t report_id = parse_report_id(self, rest_args[0]);
-    std::optional<std::filesystem::path> output_path;
-    if (rest_args[1]) {
-        output_path = rest_args[1];
+    // Comma-separated list of report IDs; only --stream accepts more than one
+    std::vector<uint8_t> report_ids;
+    for (auto part : std::string_view(rest_args[0]) | std::views::split(',')) {
+        report_ids.push_back(parse_report_id(self, std::string_view(part.begin(), part.end())));
+    }
+    char** rest = &rest_args[1];
+    recv_options opts;
+    bool keyframe_given = false;
+    for (; rest[0] && std::string_view(rest[0]).starts_with("--"); ++rest) {
+        const std::string_view opt = rest[0];
+        if (opt == "--stream") {
+            opts.stream = true;
+        } else if (opt == "--decode") {
+            opts.decode = true;
+        } else if (opt == "--capture") {
+            if (!rest[1]) {
+                throw wrong_usage_exception(self, "Missing capture file path for --capture");
+            }
+            opts.capture_path = rest[1];
+            ++rest;
+        } else if (opt == "--io-uring") {
+            opts.io_uring = true;
+        } else if (opt == "--route") {
+            const std::string_view spec = rest[1] ? rest[1] : "";
+            const auto eq = spec.find('=');
+            if (eq == std::string_view::npos || eq + 1 == spec.size()) {
+                throw wrong_usage_exception(self, "--route expects <report id>=<output file path>");
+            }
+            opts.routes.emplace_back(parse_report_id(self, spec.substr(0, eq)), std::filesystem::path(spec.substr(eq + 1)));
+            ++rest;
+        } else if (opt == "--timeout-ms") {
+            if (!rest[1]) {
+                throw wrong_usage_exception(self, "Missing value for --timeout-ms");
+            }
+            opts.timeout = std::chrono::milliseconds(parse_unsigned(self, rest[1], opt));
+            ++rest;
+        } else if (opt == "--changes-only") {
+            opts.changes_only = true;
+        } else if (opt == "--keyframe-ms") {
+            opts.keyframe_interval = std::chrono::milliseconds(parse_unsigned(self, rest[1], opt));
+            keyframe_given = true;
+            ++rest;
+        } else {
+            throw wrong_usage_exception(self, std::format("Unknown option for recv command: {}", opt));
+        }
+    }
+    if (rest[0]) {
+        opts.output_path = rest[0];
+    }
+    if (opts.io_uring && !opts.stream) {
+        throw wrong_usage_exception(self, "--io-uring requires --stream");
     }
-    return recv(dev, report_id, output_path);
+    if (!opts.stream && (report_ids.size() > 1 || !opts.routes.empty())) {
+        throw wrong_usage_exception(self, "Several report IDs and --route require --stream");
+    }
+    if (opts.timeout && opts.stream) {
+        throw wrong_usage_exception(self, "--timeout-ms applies to single reads only");
+    }
+    if (opts.capture_path && (!opts.stream || opts.output_path)) {
+        throw wrong_usage_exception(self, "--capture requires --stream and replaces the output path");
+    }
+    if ((opts.changes_only || keyframe_given) && (!opts.stream || !opts.changes_only)) {
+        throw wrong_usage_exception(self, "--changes-only requires --stream, and --keyframe-ms requires --changes-only");
+    }
+    if (opts.stream) {
+        return recv_stream(session, report_ids, opts);
+    }
+    return recv(session, report_ids[0], opts);
 }
 
-static int feature_get_handler(const interact& self, hidraw::device& dev, char* rest_args[]) {
+static int feature_get_handler(const interact& self, hid::device_session& session, char* rest_args[]) {
     if (!rest_args[0]) {
         throw wrong_usage_exception(self, "Missing arguments for feature-get command.");
     }
@@ -311,19 +1814,251 @@ static int feature_get_handler(const interact& self, hidraw::device& dev, char*
     if (rest_args[1]) {
         output_path = rest_args[1];
     }
-    return feature_get(dev, report_id, output_path);
+    return feature_get(session, report_id, output_path);
 }
 
-static int feature_set_handler(const interact& self, hidraw::device& dev, char* rest_args[]) {
+static int feature_set_handler(const interact& self, hid::device_session& session, char* rest_args[]) {
     if (!rest_args[0] || !rest_args[1]) {
         throw wrong_usage_exception(self, "Missing arguments for feature-set command.");
     }
     uint8_t report_id = parse_report_id(self, rest_args[0]);
-    std::filesystem::path hex_file_path = rest_args[1];
-    return feature_set(dev, report_id, hex_file_path);
+    const write_options opts = parse_write_options(self, &rest_args[1]);
+    if (!opts.settings.empty()) {
+        return write_settings(session, report_id, hid::device_session::field_kind::feature, opts.settings, opts.count,
+            opts.interval, "Feature", [&](const hidraw::report_buffer& report) { session.device().feature_set(report); });
+    }
+    if (opts.batch) {
+        return feature_set_batch(session, report_id, opts.hex_file_path, opts.interval);
+    }
+    return feature_set(session, report_id, opts.hex_file_path);
 }
 
-static int unknown_handler(const interact& self, hidraw::device& dev, char* rest_args[]) {
+// Parses --cpu <n> or --fifo <priority> at rest[0], leaving rest at its value.
+// Returns false for any other option.
+static bool parse_scheduling_option(const interact& self, char**& rest, std::optional<int>& cpu, std::optional<int>& fifo_priority) {
+    const std::string_view opt = rest[0];
+    if (opt == "--cpu") {
+        const uint64_t n = parse_unsigned(self, rest[1], opt);
+        if (n >= CPU_SETSIZE) {
+            throw wrong_usage_exception(self, std::format("CPU index out of range: {}", n));
+        }
+        cpu = static_cast<int>(n);
+    } else if (opt == "--fifo") {
+        const uint64_t priority = parse_unsigned(self, rest[1], opt);
+        if (priority < static_cast<uint64_t>(::sched_get_priority_min(SCHED_FIFO))
+            || priority > static_cast<uint64_t>(::sched_get_priority_max(SCHED_FIFO))) {
+            throw wrong_usage_exception(self, std::format("SCHED_FIFO priority out of range: {}", priority));
+        }
+        fifo_priority = static_cast<int>(priority);
+    } else {
+        return false;
+    }
+    ++rest;
+    return true;
+}
+
+// Parses [--mode <output|feature-get|feature-set>] [--count <n>] [--warmup <n>] [--reply-id <id>]
+// [--timeout-ms <n>] [--cpu <n>] [--fifo <priority>] [<hex data file path>]
+static int bench_handler(const interact& self, hid::device_session& session, char* rest_args[]) {
+    if (!rest_args[0]) {
+        throw wrong_usage_exception(self, "Missing arguments for bench command.");
+    }
+    uint8_t report_id = parse_report_id(self, rest_args[0]);
+    char** rest = &rest_args[1];
+    bench_options opts;
+    for (; rest[0] && std::string_view(rest[0]).starts_with("--"); ++rest) {
+        const std::string_view opt = rest[0];
+        if (opt == "--mode") {
+            const std::string_view mode = rest[1] ? rest[1] : "";
+            if (mode == "output") {
+                opts.mode = bench_mode::output;
+            } else if (mode == "feature-get") {
+                opts.mode = bench_mode::feature_get;
+            } else if (mode == "feature-set") {
+                opts.mode = bench_mode::feature_set;
+            } else {
+                throw wrong_usage_exception(self, std::format("Wrong value for --mode: {}", mode));
+            }
+            ++rest;
+        } else if (opt == "--count") {
+            opts.count = parse_unsigned(self, rest[1], opt);
+            ++rest;
+        } else if (opt == "--warmup") {
+            opts.warmup = parse_unsigned(self, rest[1], opt);
+            ++rest;
+        } else if (opt == "--reply-id") {
+            if (!rest[1]) {
+                throw wrong_usage_exception(self, "Missing value for --reply-id");
+            }
+            opts.reply_id = parse_report_id(self, rest[1]);
+            ++rest;
+        } else if (opt == "--timeout-ms") {
+            opts.timeout = std::chrono::milliseconds(parse_unsigned(self, rest[1], opt));
+            ++rest;
+        } else if (!parse_scheduling_option(self, rest, opts.cpu, opts.fifo_priority)) {
+            throw wrong_usage_exception(self, std::format("Unknown option for bench command: {}", opt));
+        }
+    }
+    if (rest[0]) {
+        opts.hex_file_path = rest[0];
+    }
+    if (opts.count == 0) {
+        throw wrong_usage_exception(self, "--count must be at least 1");
+    }
+    if (opts.reply_id && opts.mode != bench_mode::output) {
+        throw wrong_usage_exception(self, "--reply-id applies to --mode output only");
+    }
+    return bench(session, report_id, opts);
+}
+
+static int trigger_handler(const interact& self, hid::device_session& session, char* rest_args[]) {
+    if (!rest_args[0]) {
+        throw wrong_usage_exception(self, "Missing arguments for trigger command.");
+    }
+    uint8_t report_id = parse_report_id(self, rest_args[0]);
+    char** rest = &rest_args[1];
+    trigger_options opts;
+    for (; rest[0] && std::string_view(rest[0]).starts_with("--"); ++rest) {
+        const std::string_view opt = rest[0];
+        if (opt == "--feature") {
+            opts.feature = true;
+        } else if (opt == "--busy-poll") {
+            opts.busy_poll = true;
+        } else if (opt == "--reply-id") {
+            if (!rest[1]) {
+                throw wrong_usage_exception(self, "Missing value for --reply-id");
+            }
+            opts.reply_id = parse_report_id(self, rest[1]);
+            ++rest;
+        } else if (opt == "--count") {
+            opts.count = parse_unsigned(self, rest[1], opt);
+            ++rest;
+        } else if (opt == "--interval-us") {
+            opts.interval = std::chrono::microseconds(parse_unsigned(self, rest[1], opt));
+            ++rest;
+        } else if (opt == "--jitter-us") {
+            opts.jitter = std::chrono::microseconds(parse_unsigned(self, rest[1], opt));
+            ++rest;
+        } else if (opt == "--timeout-ms") {
+            opts.timeout = std::chrono::milliseconds(parse_unsigned(self, rest[1], opt));
+            ++rest;
+        } else if (opt == "--capture") {
+            if (!rest[1]) {
+                throw wrong_usage_exception(self, "Missing path for --capture");
+            }
+            opts.capture_path = rest[1];
+            ++rest;
+        } else if (!parse_scheduling_option(self, rest, opts.cpu, opts.fifo_priority)) {
+            throw wrong_usage_exception(self, std::format("Unknown option for trigger command: {}", opt));
+        }
+    }
+    if (rest[0]) {
+        opts.hex_file_path = rest[0];
+    }
+    if (opts.count == 0) {
+        throw wrong_usage_exception(self, "--count must be at least 1");
+    }
+    return trigger(session, report_id, opts);
+}
+
+static int monitor_all_handler(const interact& self, char* rest_args[]) {
+    auto backend = hidraw::monitor::backend::epoll;
+    char** rest = rest_args;
+    for (; rest[0] && std::string_view(rest[0]).starts_with("--"); ++rest) {
+        if (std::string_view(rest[0]) == "--io-uring") {
+            backend = hidraw::monitor::backend::io_uring;
+        } else {
+            throw wrong_usage_exception(self, std::format("Unknown option for monitor-all command: {}", rest[0]));
+        }
+    }
+    std::optional<std::filesystem::path> output_path;
+    if (rest[0]) {
+        output_path = rest[0];
+    }
+    return monitor_all(output_path, backend);
+}
+
+static int scan_handler(const interact& self, char* rest_args[]) {
+    std::optional<std::filesystem::path> cache_dir = hid::descriptor_cache::default_dir();
+    char** rest = rest_args;
+    for (; rest[0] && std::string_view(rest[0]).starts_with("--"); ++rest) {
+        const std::string_view opt = rest[0];
+        if (opt == "--no-cache") {
+            cache_dir.reset();
+        } else if (opt == "--cache-dir") {
+            if (!rest[1]) {
+                throw wrong_usage_exception(self, "Missing directory for --cache-dir.");
+            }
+            cache_dir = *++rest;
+        } else {
+            throw wrong_usage_exception(self, std::format("Unknown option for scan command: {}", opt));
+        }
+    }
+    std::optional<std::filesystem::path> output_path;
+    if (rest[0]) {
+        output_path = rest[0];
+    }
+    return scan(cache_dir, output_path);
+}
+
+static int inspect_handler(const interact& self, char* rest_args[]) {
+    if (!rest_args[0]) {
+        throw wrong_usage_exception(self, "Missing capture file path.");
+    }
+    return inspect(rest_args[0]);
+}
+
+static int replay_handler(const interact& self, char* rest_args[]) {
+    if (!rest_args[0]) {
+        throw wrong_usage_exception(self, "Missing capture file path.");
+    }
+    std::filesystem::path capture_path = rest_args[0];
+    char** rest = &rest_args[1];
+    bool decode = false;
+    for (; rest[0] && std::string_view(rest[0]).starts_with("--"); ++rest) {
+        if (std::string_view(rest[0]) == "--decode") {
+            decode = true;
+        } else {
+            throw wrong_usage_exception(self, std::format("Unknown option for replay command: {}", rest[0]));
+        }
+    }
+    std::optional<std::filesystem::path> output_path;
+    if (rest[0]) {
+        output_path = rest[0];
+    }
+    return replay(capture_path, decode, output_path);
+}
+
+static int export_handler(const interact& self, char* rest_args[]) {
+    if (!rest_args[0] || !rest_args[1]) {
+        throw wrong_usage_exception(self, "Missing capture file path or report ID.");
+    }
+    std::filesystem::path capture_path = rest_args[0];
+    const uint8_t report_id = parse_report_id(self, rest_args[1]);
+    char** rest = &rest_args[2];
+    std::size_t threads = std::max(std::thread::hardware_concurrency(), 1u);
+    for (; rest[0] && std::string_view(rest[0]).starts_with("--"); ++rest) {
+        if (std::string_view(rest[0]) == "--threads") {
+            threads = parse_unsigned(self, rest[1], "--threads");
+            if (threads == 0) {
+                throw wrong_usage_exception(self, "--threads must be at least 1");
+            }
+            ++rest;
+        } else {
+            throw wrong_usage_exception(self, std::format("Unknown option for export command: {}", rest[0]));
+        }
+    }
+    std::optional<std::filesystem::path> output_path;
+    if (rest[0]) {
+        output_path = rest[0];
+    }
+    return export_columns(capture_path, report_id, threads, output_path);
+}
+
+// Defined after the command table it dispatches through
+static int serve_handler(const interact& self, char* rest_args[]);
+
+static int unknown_handler(const interact& self, hid::device_session& session, char* rest_args[]) {
     throw wrong_usage_exception(self);
 }
 
@@ -351,18 +2086,86 @@ static constexpr std::string_view dump_usage = R"(  dump <hidraw device path>
 )";
 
 static constexpr std::string_view dumphid_usage = R"(  dumphid <hidraw device path> [<output file or dir>]
+  dumphid --from-file <descriptor file> [--check] [<output file or dir>]
+  dumphid --dir <descriptor dir> [--check] [--threads <n>] [<output dir>]
     - Prints HID report descriptor in a human-readable form only.
     - If <output path> is a directory, saves to a timestamped file inside.
+    - With --from-file, reads the descriptor from a file instead of a device: raw bytes, or hex text as
+      printed by dump (starting with "size:", or named *.hex).
+    - With --dir, dumps every file of <descriptor dir> to <output dir>/<file name>.txt on <n> threads
+      (default: one per CPU), printing only failures.
+    - With --check, parses each descriptor instead and prints its collection and field counts or the error.
 )";
 
-static constexpr std::string_view send_usage = R"(  send <hidraw device path> <report id> <hex data file path>
+static constexpr std::string_view send_usage = R"(  send <hidraw device path> <report id> [--batch] [--interval-us <n>] <hex data file path>
+  send <hidraw device path> <report id> --set <usage>=<value>... [--count <n>] [--interval-us <n>]
     - Sends an output report to the device.
+    - With --batch, sends every line of the hex file as one report, after validating all of them.
+    - With --interval-us, waits <n> microseconds between batched or repeated reports.
+    - With --set, builds the report from field values instead: unset fields are zero, values are clamped
+      to the field's logical range, and array usages are selected by a non-zero value. <usage> is a name
+      as printed by recv --decode (e.g. X, "Button 3"), <page>:<usage>, or a usage number of the report.
+    - With --count, sends the --set report <n> times.
 )";
 
-static constexpr std::string_view recv_usage = R"(  recv <hidraw device path> <report id> [<output hex data file path>]
-    - Receives an input report from the device.
+static constexpr std::string_view recv_usage = R"(  recv <hidraw device path> <report id>[,<report id>...] [--stream] [--decode] [--capture <capture file>] [--io-uring]
+       [--route <report id>=<output file path>]... [--changes-only [--keyframe-ms <n>]] [--timeout-ms <n>]
+       [<output hex data file path>]
+    - Receives an input report with the given ID from the device; reports with other IDs are skipped.
     - If <output hex data file path> is a directory, saves the report as a hex file in that directory named by timestamp.
     - If <output hex data file path> is not provided, prints to stdout.
+    - With --stream, keeps receiving reports until Ctrl+C and writes one timestamped line per report
+      to stdout or to <output hex data file path>. Formatting and writes run on their own thread, so a
+      slow output does not stall reads; the closing summary reports the ring's peak use and any overruns.
+    - With --decode, prints field values named by usage instead of raw bytes; a single report is saved the
+      same way as a hex report, with a .txt name in a directory.
+    - With --stream --capture, writes reports to a binary capture file instead (see inspect/replay).
+    - With --stream --io-uring, reads through io_uring, draining each wakeup with a chain of linked reads (epoll if unavailable).
+    - With --stream, several comma-separated report IDs may be given; unlisted IDs are dropped unread.
+      Each --route writes one more report ID to its own file instead of the main output.
+    - With --stream --changes-only, drops reports identical to the previous one of their ID. With --decode,
+      a changed report lists only the fields that changed ("ID n (x bytes) changed: ..."), released array
+      usages as 0. Every --keyframe-ms (default 1000, 0 for only the first) each ID is written in full.
+    - With --timeout-ms, gives up on a single read after <n> milliseconds without a report.
+)";
+
+static constexpr std::string_view serve_usage = R"(  serve [--socket <path>]
+    - Reads newline-delimited commands from stdin, or from clients of a Unix socket at <path>, and runs
+      them with the same verbs and arguments as on the command line (e.g. "feature-get /dev/hidraw0 1").
+    - Devices stay open and their descriptors parsed between commands, so a request costs only its ioctls.
+    - Each response is the command's output followed by a line ".ok" or ".error <message>". Requests may
+      be pipelined; responses come back in order and are flushed whenever no further request is buffered.
+    - Arguments containing spaces are written in double quotes, e.g. --set "Button 3=1".
+)";
+
+static constexpr std::string_view inspect_usage = R"(  inspect <capture file>
+    - Summarises a binary capture file: descriptor, record counts per kind and report ID, duration.
+)";
+
+static constexpr std::string_view replay_usage = R"(  replay <capture file> [--decode] [<output file path>]
+    - Prints every record of a binary capture file, one timestamped line each.
+    - With --decode, input reports are decoded with the descriptor embedded in the capture.
+)";
+
+static constexpr std::string_view export_usage = R"(  export <capture file> <report id> [--threads <n>] [<output csv path>]
+    - Decodes every input report with the given ID of a binary capture file into CSV: a timestamp column,
+      then one column per field value in report order. Array fields hold the raw logical value.
+    - Reports are decoded field by field and formatted in batches of max(65536, <n> * 16384), cut into
+      chunks of 16384 reports that are spread across <n> threads (default: one per CPU). Captures with
+      fewer reports than that use fewer threads.
+)";
+
+static constexpr std::string_view monitor_all_usage = R"(  monitor-all [--io-uring] [<output file path>]
+    - Streams input reports from every /dev/hidraw* node until Ctrl+C, one line per report tagged with the node name.
+    - Nodes plugged in or removed while running are picked up or dropped automatically.
+    - With --io-uring, drains each node through io_uring with a chain of linked reads per wakeup (epoll if unavailable).
+)";
+
+static constexpr std::string_view scan_usage = R"(  scan [--cache-dir <dir> | --no-cache] [<output file path>]
+    - Opens every /dev/hidraw* node and prints one JSON line per device: bus, vendor/product IDs, name,
+      physical address, descriptor size, hash and a summary of its collections and report IDs.
+    - Each distinct descriptor is parsed once. Summaries and annotated dumps are cached as <hash>.txt
+      in <dir> (default: $XDG_CACHE_HOME/hidtool/descriptors); --no-cache keeps them in memory only.
 )";
 
 static constexpr std::string_view feature_get_usage = R"(  feature-get <hidraw device path> <report id> [<output hex data file path>]
@@ -371,8 +2174,45 @@ static constexpr std::string_view feature_get_usage = R"(  feature-get <hidraw d
     - If <output hex data file path> is not provided, prints to stdout.
 )";
 
-static constexpr std::string_view feature_set_usage = R"(  feature-set <hidraw device path> <report id> <hex data file path>
+static constexpr std::string_view feature_set_usage = R"(  feature-set <hidraw device path> <report id> [--batch] [--interval-us <n>] <hex data file path>
+  feature-set <hidraw device path> <report id> --set <usage>=<value>... [--count <n>] [--interval-us <n>]
     - Sets a feature report to the device.
+    - With --batch, sets every line of the hex file as one report, after validating all of them.
+    - With --interval-us, waits <n> microseconds between batched or repeated reports.
+    - --set and --count build the report from field values as for send.
+)";
+
+static constexpr std::string_view bench_usage = R"(  bench <hidraw device path> <report id> [--mode output|feature-get|feature-set] [--count <n>] [--warmup <n>]
+        [--reply-id <report id>] [--timeout-ms <n>] [--cpu <n>] [--fifo <priority>] [<hex data file path>]
+    - Times <n> report round trips (default 1000, after 10 warm-up ones) and prints min/p50/p99/p99.9/max
+      latency and the achieved rate.
+    - --mode output (default) writes an output report and waits for the next input report with
+      --reply-id (default: the same ID), at most --timeout-ms (default 1000) each.
+    - --mode feature-get and feature-set time the GET_REPORT / SET_REPORT ioctls on a feature report.
+    - The report payload is read from <hex data file path>, or is all zeros.
+    - --cpu pins the benchmark to one CPU; --fifo runs it under SCHED_FIFO with <priority> (needs CAP_SYS_NICE).
+)";
+
+static constexpr std::string_view trigger_usage = R"(  trigger <hidraw device path> <report id> [--feature] [--reply-id <report id>] [--count <n>] [--interval-us <n>]
+          [--jitter-us <n>] [--timeout-ms <n>] [--busy-poll] [--cpu <n>] [--fifo <priority>] [--capture <capture file>]
+          [<hex data file path>]
+    - Sends an output report (a feature report with --feature, through SET_REPORT) <n> times (default 100)
+      and after each waits up to --timeout-ms (default 1000) for the first input report with --reply-id
+      (default: the same ID). Input reports already queued before a trigger are discarded first.
+    - Prints the send-to-reply latency: percentiles, mean and standard deviation, and a histogram.
+    - Triggers start every --interval-us (default 10000) plus a uniformly random 0..--jitter-us delay, so
+      they do not lock to the device's polling interval.
+    - With --busy-poll, polls the device without sleeping while waiting for a reply.
+    - With --capture, records every sent and received report, timestamped with CLOCK_MONOTONIC_RAW.
+    - The report payload is read from <hex data file path>, or is all zeros. --cpu and --fifo behave as for bench.
+)";
+
+static constexpr std::string_view stats_usage = R"(  --stats [--stats-interval-ms <n>] [--stats-socket <path>] [--stats-format text|json|prometheus] <command> ...
+    - Counts reports per ID, bytes written, short reads, dropped reports and pipe overruns, and times
+      read/write/feature ioctl syscalls and decoding; prints them to stderr when the command ends.
+    - --stats-interval-ms also prints them every <n> ms, with per-ID report rates.
+    - --stats-socket serves them on a Unix socket, once per connection, as --stats-format (default prometheus).
+    - Only available when built with counters (xmake f --counters=y); they cost nothing otherwise.
 )";
 
 template<const std::string_view&... usages>
@@ -391,8 +2231,17 @@ static constexpr auto raw_usage = make_raw_usage<
     dumphid_usage,
     send_usage,
     recv_usage,
+    monitor_all_usage,
+    scan_usage,
+    serve_usage,
+    inspect_usage,
+    replay_usage,
+    export_usage,
     feature_get_usage,
-    feature_set_usage
+    feature_set_usage,
+    bench_usage,
+    trigger_usage,
+    stats_usage
 >();
 
 static constexpr std::string_view usage = std::string_view(raw_usage.begin(), std::ranges::find(raw_usage, '\0'));
@@ -402,11 +2251,19 @@ static constexpr auto help_command = "help";
 static constexpr auto commands = [] {
     auto cmds = std::to_array<interact>({
         {"dump", &dump_handler, dump_usage},
-        {"dumphid", &dumphid_handler, dumphid_usage},
+        {"dumphid", &dumphid_handler, dumphid_usage, &dumphid_offline_handler},
         {"send", &send_handler, send_usage},
         {"recv", &recv_handler, recv_usage},
+        {"monitor-all", nullptr, monitor_all_usage, &monitor_all_handler},
+        {"scan", nullptr, scan_usage, &scan_handler},
+        {"serve", nullptr, serve_usage, &serve_handler},
+        {"inspect", nullptr, inspect_usage, &inspect_handler},
+        {"replay", nullptr, replay_usage, &replay_handler},
+        {"export", nullptr, export_usage, &export_handler},
         {"feature-get", &feature_get_handler, feature_get_usage},
         {"feature-set", &feature_set_handler, feature_set_usage},
+        {"bench", &bench_handler, bench_usage},
+        {"trigger", &trigger_handler, trigger_usage},
     });
     std::ranges::sort(cmds, {}, &interact::command);
     return cmds;
@@ -420,12 +2277,266 @@ static void display_usage(std::string_view self, std::string_view usage) {
     std::println("{}", usage);
 }
 
-int main(int argc, char* argv[]) {
+// Splits a request line into arguments on blanks; double quotes group words.
+static std::vector<std::string> split_request(std::string_view line) {
+    std::vector<std::string> args;
+    std::string arg;
+    bool in_arg = false;
+    bool quoted = false;
+    for (char c : line) {
+        if (c == '"') {
+            quoted = !quoted;
+            in_arg = true;
+        } else if (!quoted && (c == ' ' || c == '\t' || c == '\r')) {
+            if (in_arg) args.push_back(std::exchange(arg, {}));
+            in_arg = false;
+        } else {
+            arg += c;
+            in_arg = true;
+        }
+    }
+    if (quoted) {
+        throw std::runtime_error("Unterminated quote");
+    }
+    if (in_arg) args.push_back(std::move(arg));
+    return args;
+}
+
+// Reads lines from a file descriptor; before blocking for more input it calls
+// on_idle, which is where serve flushes the responses to pipelined requests.
+class line_reader
+{
+public:
+    explicit line_reader(int fd) : fd(fd) {}
+
+    template<typename Idle>
+    bool next(std::string& line, Idle&& on_idle) {
+        for (;;) {
+            const auto nl = buffer.find('\n', pos);
+            if (nl != std::string::npos) {
+                line.assign(buffer, pos, nl - pos);
+                pos = nl + 1;
+                return true;
+            }
+            buffer.erase(0, pos);
+            pos = 0;
+            on_idle();
+            char chunk[4096];
+            const ::ssize_t n = ::read(fd, chunk, sizeof(chunk));
+            if (n < 0 && errno == EINTR) continue;
+            if (n <= 0) {
+                // A final line without a newline still counts
+                if (buffer.empty()) return false;
+                line = std::exchange(buffer, {});
+                return true;
+            }
+            buffer.append(chunk, static_cast<std::size_t>(n));
+        }
+    }
+
+private:
+    int fd;
+    std::string buffer;
+    std::size_t pos = 0;
+};
+
+using session_map = std::map<std::string, hid::device_session, std::less<>>;
+
+// Runs one request through the command table and prints its status line.
+static void serve_request(std::string_view line, session_map& sessions) {
+    std::string device_path;
     try {
-        if (argc < 2) {
+        auto args = split_request(line);
+        if (args.empty()) {
+            return;
+        }
+        if (args[0] == help_command) {
+            std::print("{}", usage);
+            std::println(".ok");
+            return;
+        }
+        const auto eq = std::ranges::equal_range(commands, std::string_view(args[0]), {}, &interact::command);
+        if (eq.empty()) {
+            throw std::runtime_error(std::format("Unknown command: {}", args[0]));
+        }
+        const interact& cmd = eq[0];
+        if (cmd.global_handler == &serve_handler) {
+            throw std::runtime_error("serve cannot be nested");
+        }
+        std::vector<char*> argv;
+        for (auto& arg : args) argv.push_back(arg.data());
+        argv.push_back(nullptr);
+
+        int rc;
+        if (runs_without_device(cmd, argv[1])) {
+            rc = cmd.global_handler(cmd, &argv[1]);
+        } else {
+            if (args.size() < 2) {
+                throw std::runtime_error("Missing hidraw device path.");
+            }
+            device_path = args[1];
+            auto it = sessions.find(device_path);
+            if (it == sessions.end()) {
+                it = sessions.try_emplace(device_path, hidraw::device(device_path)).first;
+            }
+            // recv --stream and the monitors leave the device non-blocking
+            it->second.device().set_mode(hidraw::open_mode::blocking);
+            rc = cmd.handler(cmd, it->second, &argv[2]);
+        }
+        if (rc == 0) {
+            std::println(".ok");
+        } else {
+            std::println(".error exit status {}", rc);
+        }
+    } catch (const std::exception& e) {
+        // A failed ioctl usually means the device went away; reopen it on the next request
+        if (dynamic_cast<const std::system_error*>(&e) && !device_path.empty()) {
+            sessions.erase(device_path);
+        }
+        std::string message = e.what();
+        std::ranges::replace(message, '\n', ' ');
+        std::println(".error {}", message);
+    }
+}
+
+static void serve_stream(int fd, session_map& sessions) {
+    line_reader in(fd);
+    std::string line;
+    while (in.next(line, [] { std::fflush(stdout); })) {
+        serve_request(line, sessions);
+    }
+    std::fflush(stdout);
+}
+
+// Serves one client at a time on a Unix socket, with stdout pointed at the
+// connection so command output and status lines reach the client. Devices
+// stay open across clients.
+static int serve_socket(const std::filesystem::path& path, session_map& sessions) {
+    ::sockaddr_un addr{};
+    addr.sun_family = AF_UNIX;
+    if (path.native().size() >= sizeof(addr.sun_path)) {
+        throw std::runtime_error(std::format("Socket path too long: {}", path.string()));
+    }
+    std::ranges::copy(path.native(), addr.sun_path);
+
+    const int listener = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (listener < 0) {
+        throw std::system_error(errno, std::system_category(), "Failed to create socket");
+    }
+    struct fd_guard {
+        int fd;
+        ~fd_guard() { ::close(fd); }
+    } listener_guard{listener};
+    // A socket left behind by an earlier serve would make bind() fail
+    std::error_code ec;
+    if (std::filesystem::is_socket(path, ec)) {
+        std::filesystem::remove(path, ec);
+    }
+    if (::bind(listener, reinterpret_cast<const ::sockaddr*>(&addr), sizeof(addr)) < 0 || ::listen(listener, 8) < 0) {
+        throw std::system_error(errno, std::system_category(), std::format("Failed to listen on {}", path.string()));
+    }
+    // A client that hangs up mid-response must not take the server down
+    ::signal(SIGPIPE, SIG_IGN);
+    std::println(stderr, "[Serving] {}", path.string());
+
+    const int saved_stdout = ::dup(STDOUT_FILENO);
+    for (;;) {
+        const int client = ::accept4(listener, nullptr, nullptr, SOCK_CLOEXEC);
+        if (client < 0) {
+            if (errno == EINTR || errno == ECONNABORTED) continue;
+            throw std::system_error(errno, std::system_category(), "Failed to accept connection");
+        }
+        std::fflush(stdout);
+        ::dup2(client, STDOUT_FILENO);
+        serve_stream(client, sessions);
+        std::clearerr(stdout);
+        ::dup2(saved_stdout, STDOUT_FILENO);
+        ::close(client);
+    }
+}
+
+static int serve_handler(const interact& self, char* rest_args[]) {
+    std::optional<std::filesystem::path> socket_path;
+    char** rest = rest_args;
+    for (; rest[0] && std::string_view(rest[0]).starts_with("--"); ++rest) {
+        const std::string_view opt = rest[0];
+        if (opt == "--socket") {
+            if (!rest[1]) {
+                throw wrong_usage_exception(self, "Missing path for --socket");
+            }
+            socket_path = rest[1];
+            ++rest;
+        } else {
+            throw wrong_usage_exception(self, std::format("Unknown option for serve command: {}", opt));
+        }
+    }
+    if (rest[0]) {
+        throw wrong_usage_exception(self, std::format("Unexpected argument for serve command: {}", rest[0]));
+    }
+    session_map sessions;
+    if (socket_path) {
+        return serve_socket(*socket_path, sessions);
+    }
+    serve_stream(STDIN_FILENO, sessions);
+    return 0;
+}
+
+// Consumes the --stats options in front of the command; nullopt if there are none.
+static std::optional<hid::stats::reporter::options> parse_stats_options(char**& arg) {
+    std::optional<hid::stats::reporter::options> opts;
+    for (; arg[0] && std::string_view(arg[0]).starts_with("--stats"); ++arg) {
+        const std::string_view opt = arg[0];
+        if (!hid::stats::enabled) {
+            throw wrong_usage_exception(unknown_command,
+                std::format("{} needs a build with counters (xmake f --counters=y)", opt));
+        }
+        auto& o = opts ? *opts : opts.emplace();
+        if (opt == "--stats") {
+            continue;
+        }
+        if (opt == "--stats-interval-ms") {
+            const uint64_t ms = parse_unsigned(unknown_command, arg[1], opt);
+            if (ms == 0 || ms > std::numeric_limits<int>::max()) {
+                throw wrong_usage_exception(unknown_command, std::format("Wrong value for {}: {}", opt, arg[1]));
+            }
+            o.interval = std::chrono::milliseconds(ms);
+        } else if (opt == "--stats-socket") {
+            if (!arg[1]) {
+                throw wrong_usage_exception(unknown_command, "Missing path for --stats-socket");
+            }
+            o.socket_path = arg[1];
+        } else if (opt == "--stats-format") {
+            const std::string_view fmt = arg[1] ? arg[1] : "";
+            if (fmt == "text") {
+                o.socket_format = hid::stats::format::text;
+            } else if (fmt == "json") {
+                o.socket_format = hid::stats::format::json;
+            } else if (fmt == "prometheus") {
+                o.socket_format = hid::stats::format::prometheus;
+            } else {
+                throw wrong_usage_exception(unknown_command, std::format("Wrong value for --stats-format: {}", fmt));
+            }
+        } else {
+            throw wrong_usage_exception(unknown_command, std::format("Unknown option: {}", opt));
+        }
+        ++arg;
+    }
+    return opts;
+}
+
+int main(int, char* argv[]) {
+    try {
+        char** args = &argv[1];
+        const auto stats_options = parse_stats_options(args);
+        if (!args[0]) {
             throw wrong_usage_exception(unknown_command, "Missing command.");
         }
-        const std::string_view command = argv[1];
+        // Outlives the command, then prints the final counters
+        std::optional<hid::stats::reporter> stats_reporter;
+        if (stats_options) {
+            stats_reporter.emplace(*stats_options);
+        }
+        const std::string_view command = args[0];
         if (command == help_command) {
             display_usage(argv[0], usage);
             return 0;
@@ -435,12 +2546,15 @@ int main(int argc, char* argv[]) {
             throw wrong_usage_exception(unknown_command, std::format("Unknown command: {}", command));
         }
         const auto& interact = eq[0];
-        if (argc < 3) {
+        if (runs_without_device(interact, args[1])) {
+            return interact.global_handler(interact, &args[1]);
+        }
+        if (!args[1]) {
             throw wrong_usage_exception(interact, "Missing hidraw device path.");
         }
-        hidraw::device dev(argv[2]);
-        std::println("[Opened device] {}", argv[2]);
-        return interact.handler(interact, dev, &argv[3]);
+        hid::device_session session{hidraw::device(args[1])};
+        std::println("[Opened device] {}", args[1]);
+        return interact.handler(interact, session, &args[2]);
     } catch (const wrong_usage_exception& e) {
         std::println("Error: {}", e.what());
         display_usage(argv[0], e.usage());
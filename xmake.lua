@@ -1,8 +1,40 @@
 add_rules("mode.debug", "mode.release")
 set_languages("c++23")
 add_includedirs("inc")
-add_files("src/*.cpp")
 add_rules("plugin.compile_commands.autoupdate", {outputdir = "./"})
 
+-- xmake f --counters=y compiles in the hot-path counters behind --stats
+option("counters")
+    set_default(false)
+    set_showmenu(true)
+    set_description("Enable hot-path counters and latency histograms")
+    add_defines("HIDTOOL_COUNTERS")
+option_end()
+
+-- Applied to every target, so the library and the tools agree on the registry
+add_options("counters")
+
+target("hid")
+    set_kind("static")
+    add_files("src/*.cpp|main.cpp")
+
 target("hidtool")
     set_kind("binary")
+    add_files("src/main.cpp")
+    add_deps("hid")
+
+-- xmake build hidbench && xmake run hidbench [--filter <substring>] [--min-time-ms <n>]
+target("hidbench")
+    set_kind("binary")
+    set_default(false)
+    add_files("bench/*.cpp")
+    add_deps("hid")
+
+-- xmake f --toolchain=clang && xmake build fuzz_descriptor && xmake run fuzz_descriptor [<corpus dir>]
+-- The library sources are built into the target so libFuzzer sees their coverage.
+target("fuzz_descriptor")
+    set_kind("binary")
+    set_default(false)
+    add_files("fuzz/*.cpp", "src/*.cpp|main.cpp")
+    add_cxflags("-fsanitize=fuzzer,address,undefined", "-fno-omit-frame-pointer")
+    add_ldflags("-fsanitize=fuzzer,address,undefined")